@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "TableGenBackends.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerUnion.h"
@@ -18,10 +19,20 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Path.h"
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Record.h"
 #include "llvm/TableGen/StringToOffsetTable.h"
@@ -30,6 +41,8 @@
 #include <cctype>
 #include <functional>
 #include <map>
+#include <mutex>
+#include <numeric>
 #include <set>
 using namespace llvm;
 
@@ -479,12 +492,15 @@ static StringRef getModifierName(ModifierType MT) {
   llvm_unreachable("invalid modifier type");
 }
 
+/// Pieces are allocated in the DiagnosticTextBuilder's arena and are never
+/// destroyed individually, so they and their derived classes must stay
+/// trivially destructible: child lists and strings are ArrayRefs and StringRefs
+/// into the arena or into the original record text.
 struct Piece {
   // This type and its derived classes are move-only.
   Piece(PieceKind Kind) : ClassKind(Kind) {}
   Piece(Piece const &O) = delete;
   Piece &operator=(Piece const &) = delete;
-  virtual ~Piece() {}
 
   PieceKind getPieceClass() const { return ClassKind; }
   static bool classof(const Piece *) { return true; }
@@ -495,10 +511,10 @@ private:
 
 struct MultiPiece : Piece {
   MultiPiece() : Piece(MultiPieceClass) {}
-  MultiPiece(std::vector<Piece *> Pieces)
-      : Piece(MultiPieceClass), Pieces(std::move(Pieces)) {}
+  MultiPiece(ArrayRef<Piece *> Pieces)
+      : Piece(MultiPieceClass), Pieces(Pieces) {}
 
-  std::vector<Piece *> Pieces;
+  ArrayRef<Piece *> Pieces;
 
   static bool classof(const Piece *P) {
     return P->getPieceClass() == MultiPieceClass;
@@ -507,9 +523,9 @@ struct MultiPiece : Piece {
 
 struct TextPiece : Piece {
   StringRef Role;
-  std::string Text;
+  StringRef Text;
   TextPiece(StringRef Text, StringRef Role = "")
-      : Piece(TextPieceClass), Role(Role), Text(Text.str()) {}
+      : Piece(TextPieceClass), Role(Role), Text(Text) {}
 
   static bool classof(const Piece *P) {
     return P->getPieceClass() == TextPieceClass;
@@ -536,7 +552,7 @@ public:
   SelectPiece(ModifierType ModKind) : SelectPiece(SelectPieceClass, ModKind) {}
 
   ModifierType ModKind;
-  std::vector<Piece *> Options;
+  ArrayRef<Piece *> Options;
   int Index = 0;
 
   static bool classof(const Piece *P) {
@@ -548,7 +564,7 @@ public:
 struct PluralPiece : SelectPiece {
   PluralPiece() : SelectPiece(PluralPieceClass, MT_Plural) {}
 
-  std::vector<Piece *> OptionPrefixes;
+  ArrayRef<Piece *> OptionPrefixes;
   int Index = 0;
 
   static bool classof(const Piece *P) {
@@ -570,17 +586,42 @@ struct DiffPiece : Piece {
 struct SubstitutionPiece : Piece {
   SubstitutionPiece() : Piece(SubstitutionPieceClass) {}
 
-  std::string Name;
-  std::vector<int> Modifiers;
+  StringRef Name;
+  ArrayRef<int> Modifiers;
 
   static bool classof(const Piece *P) {
     return P->getPieceClass() == SubstitutionPieceClass;
   }
 };
 
-/// Diagnostic text, parsed into pieces.
+/// The printed expansions of substitutions, keyed by the substituted text and
+/// the modifier mappings it was expanded with. OutputTy is the printer's
+/// output container; an expansion is whatever the printer appended to it.
+template <class OutputTy> class SubstitutionCache {
+  std::mutex Lock;
+  std::map<std::pair<const Piece *, std::vector<int>>, OutputTy> Expansions;
 
+public:
+  /// Append the cached expansion to \p Out and return true, if there is one.
+  bool lookup(const Piece *Substitution, const std::vector<int> &Mappings,
+              OutputTy &Out) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto It = Expansions.find(std::make_pair(Substitution, Mappings));
+    if (It == Expansions.end())
+      return false;
+    Out.insert(Out.end(), It->second.begin(), It->second.end());
+    return true;
+  }
 
+  void insert(const Piece *Substitution, const std::vector<int> &Mappings,
+              OutputTy Expansion) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Expansions.try_emplace(std::make_pair(Substitution, Mappings),
+                           std::move(Expansion));
+  }
+};
+
+/// Diagnostic text, parsed into pieces.
 struct DiagnosticTextBuilder {
   DiagnosticTextBuilder(DiagnosticTextBuilder const &) = delete;
   DiagnosticTextBuilder &operator=(DiagnosticTextBuilder const &) = delete;
@@ -590,7 +631,9 @@ struct DiagnosticTextBuilder {
     for (auto *S : Records.getAllDerivedDefinitions("TextSubstitution")) {
       EvaluatingRecordGuard Guard(&EvaluatingRecord, S);
       Substitutions.try_emplace(
-          S->getName(), DiagText(*this, S->getValueAsString("Substitution")));
+          S->getName(),
+          DiagText(*this, Allocator, S->getValueAsString("Substitution"))
+              .Root);
     }
 
     // Check that no diagnostic definitions have the same name as a
@@ -605,15 +648,24 @@ struct DiagnosticTextBuilder {
     }
   }
 
-  std::vector<std::string> buildForDocumentation(StringRef Role,
-                                                 const Record *R);
-  std::string buildForDefinition(const Record *R);
+  /// Build the definition text of each diagnostic in \p Diags, in the same
+  /// order. May run on several threads.
+  std::vector<std::string> buildForDefinitions(ArrayRef<const Record *> Diags);
+
+  /// Build the documentation text of each (role, diagnostic) pair in \p Diags,
+  /// in the same order. May run on several threads.
+  std::vector<std::vector<std::string>> buildForDocumentations(
+      ArrayRef<std::pair<std::string, const Record *>> Diags);
+
+  /// Build the bytecode form of the text of each diagnostic in \p Diags, in
+  /// the same order. May run on several threads.
+  std::vector<std::string> buildBytecodes(ArrayRef<const Record *> Diags);
 
   Piece *getSubstitution(SubstitutionPiece *S) const {
     auto It = Substitutions.find(S->Name);
     if (It == Substitutions.end())
       PrintFatalError("Failed to find substitution with name: " + S->Name);
-    return It->second.Root;
+    return It->second;
   }
 
   [[noreturn]] void PrintFatalError(llvm::Twine const &Msg) const {
@@ -621,21 +673,37 @@ struct DiagnosticTextBuilder {
     llvm::PrintFatalError(EvaluatingRecord->getLoc(), Msg);
   }
 
+  // Substitution expansions shared by every diagnostic, one cache per printer.
+  SubstitutionCache<std::string> DefinitionSubstitutions;
+  SubstitutionCache<std::string> BytecodeSubstitutions;
+  SubstitutionCache<std::vector<std::string>> DocumentationSubstitutions;
+
 private:
   struct DiagText {
     DiagnosticTextBuilder &Builder;
-    std::vector<Piece *> AllocatedPieces;
+    BumpPtrAllocator &Allocator;
     Piece *Root = nullptr;
 
     template <class T, class... Args> T *New(Args &&... args) {
       static_assert(std::is_base_of<Piece, T>::value, "must be piece");
-      T *Mem = new T(std::forward<Args>(args)...);
-      AllocatedPieces.push_back(Mem);
-      return Mem;
+      static_assert(std::is_trivially_destructible<T>::value,
+                    "arena-allocated pieces are never destroyed");
+      return new (Allocator.Allocate<T>()) T(std::forward<Args>(args)...);
+    }
+
+    /// Copy a list of child pieces or modifiers into the arena.
+    template <class T> ArrayRef<T> copyArray(ArrayRef<T> Elts) {
+      if (Elts.empty())
+        return None;
+      T *Mem = Allocator.Allocate<T>(Elts.size());
+      std::uninitialized_copy(Elts.begin(), Elts.end(), Mem);
+      return makeArrayRef(Mem, Elts.size());
     }
 
-    DiagText(DiagnosticTextBuilder &Builder, StringRef Text)
-        : Builder(Builder), Root(parseDiagText(Text, StopAt::End)) {}
+    DiagText(DiagnosticTextBuilder &Builder, BumpPtrAllocator &Allocator,
+             StringRef Text)
+        : Builder(Builder), Allocator(Allocator),
+          Root(parseDiagText(Text, StopAt::End)) {}
 
     enum class StopAt {
       // Parse until the end of the string.
@@ -649,21 +717,22 @@ private:
     Piece *parseDiagText(StringRef &Text, StopAt Stop);
     int parseModifier(StringRef &) const;
 
-  public:
-    DiagText(DiagText &&O) noexcept
-        : Builder(O.Builder), AllocatedPieces(std::move(O.AllocatedPieces)),
-          Root(O.Root) {
-      O.Root = nullptr;
-    }
-
-    ~DiagText() {
-      for (Piece *P : AllocatedPieces)
-        delete P;
-    }
   };
 
 private:
-  const Record *EvaluatingRecord = nullptr;
+  std::vector<std::string> buildForDocumentation(StringRef Role,
+                                                 const Record *R,
+                                                 BumpPtrAllocator &Alloc);
+  std::string buildForDefinition(const Record *R, BumpPtrAllocator &Alloc);
+  std::string buildBytecode(const Record *R, BumpPtrAllocator &Alloc);
+
+  /// Invoke \p Fn on every index below \p N, in chunks that each get their
+  /// own scratch allocator for the pieces parsed while handling them.
+  void forEachDiag(size_t N,
+                   function_ref<void(size_t, BumpPtrAllocator &)> Fn) const;
+
+  // Thread-local so that diagnostics can be built concurrently.
+  static thread_local const Record *EvaluatingRecord;
   struct EvaluatingRecordGuard {
     EvaluatingRecordGuard(const Record **Dest, const Record *New)
         : Dest(Dest), Old(*Dest) {
@@ -674,7 +743,10 @@ private:
     const Record *Old;
   };
 
-  StringMap<DiagText> Substitutions;
+  /// Backing storage for the substitutions, which are shared read-only by
+  /// every diagnostic.
+  BumpPtrAllocator Allocator;
+  StringMap<Piece *> Substitutions;
 };
 
 template <class Derived> struct DiagTextVisitor {
@@ -734,9 +806,18 @@ public:
     }
   }
 
+  /// Expand a substitution, reusing the output of an earlier expansion of the
+  /// same substitution with the same mappings where there is one.
   void VisitSubstitution(SubstitutionPiece *P) {
     SubstitutionContext Guard(*this, P);
+    auto &Cache = getDerived().getSubstitutionCache();
+    auto &Out = getDerived().getOutput();
+    if (Cache.lookup(Guard.Substitution, *ModifierMappings, Out))
+      return;
+    size_t Start = Out.size();
     Visit(Guard.Substitution);
+    Cache.insert(Guard.Substitution, *ModifierMappings,
+                 {Out.begin() + Start, Out.end()});
   }
 
   int mapIndex(int Idx,
@@ -795,6 +876,11 @@ struct DiagTextDocPrinter : DiagTextVisitor<DiagTextDocPrinter> {
                      std::vector<std::string> &RST)
       : BaseTy(Builder), RST(RST) {}
 
+  std::vector<std::string> &getOutput() { return RST; }
+  SubstitutionCache<std::vector<std::string>> &getSubstitutionCache() {
+    return Builder.DocumentationSubstitutions;
+  }
+
   void gatherNodes(
       Piece *OrigP, const ModifierMappingsType &CurrentMappings,
       std::vector<std::pair<Piece *, ModifierMappingsType>> &Pieces) const {
@@ -917,16 +1003,13 @@ struct DiagTextDocPrinter : DiagTextVisitor<DiagTextDocPrinter> {
     PlaceholderPiece E(MT_Placeholder, P->Indexes[0]);
     PlaceholderPiece F(MT_Placeholder, P->Indexes[1]);
 
-    MultiPiece FirstOption;
-    FirstOption.Pieces.push_back(P->Parts[0]);
-    FirstOption.Pieces.push_back(&E);
-    FirstOption.Pieces.push_back(P->Parts[1]);
-    FirstOption.Pieces.push_back(&F);
-    FirstOption.Pieces.push_back(P->Parts[2]);
+    Piece *FirstOptionPieces[] = {P->Parts[0], &E, P->Parts[1], &F,
+                                  P->Parts[2]};
+    MultiPiece FirstOption(FirstOptionPieces);
 
+    Piece *SelectOptions[] = {&FirstOption, P->Parts[3]};
     SelectPiece Select(MT_Diff);
-    Select.Options.push_back(&FirstOption);
-    Select.Options.push_back(P->Parts[3]);
+    Select.Options = SelectOptions;
 
     VisitSelect(&Select);
   }
@@ -940,6 +1023,11 @@ public:
   DiagTextPrinter(DiagnosticTextBuilder &Builder, std::string &Result)
       : BaseTy(Builder), Result(Result) {}
 
+  std::string &getOutput() { return Result; }
+  SubstitutionCache<std::string> &getSubstitutionCache() {
+    return Builder.DefinitionSubstitutions;
+  }
+
   void VisitMulti(MultiPiece *P) {
     for (auto *Child : P->Pieces)
       Visit(Child);
@@ -1001,6 +1089,193 @@ public:
   std::string &Result;
 };
 
+/// Opcodes of the diagnostic text bytecode. The values are emitted alongside
+/// the bytecode itself, so they may change freely.
+enum DiagBytecodeOp : uint8_t {
+  DBO_Text = 1,
+  DBO_Arg,
+  DBO_Q,
+  DBO_Ordinal,
+  DBO_ObjCClass,
+  DBO_ObjCInstance,
+  DBO_S,
+  DBO_Select,
+  DBO_Plural,
+  DBO_Diff,
+};
+
+static const std::pair<DiagBytecodeOp, StringRef> DiagBytecodeOpNames[] = {
+    {DBO_Text, "Text"},         {DBO_Arg, "Arg"},
+    {DBO_Q, "Q"},               {DBO_Ordinal, "Ordinal"},
+    {DBO_ObjCClass, "ObjCClass"}, {DBO_ObjCInstance, "ObjCInstance"},
+    {DBO_S, "S"},               {DBO_Select, "Select"},
+    {DBO_Plural, "Plural"},     {DBO_Diff, "Diff"},
+};
+
+/// Lower diagnostic text into a bytecode that can be interpreted without
+/// re-parsing the format string. All integers are ULEB128-encoded, argument
+/// indices have substitutions applied, and nested text is a length-prefixed
+/// <body> so that unselected alternatives can be skipped:
+///
+/// \code
+///   Text   <len> <bytes>          literal text with '%' escapes resolved
+///   Arg    <arg>                  %0 (likewise Q, Ordinal, ObjCClass and
+///                                 ObjCInstance for their modifiers)
+///   S      <arg>                  %s0
+///   Select <arg> <n> <body>*n     %select{...|...}0
+///   Plural <arg> <n> (<nconds> (<mod> <lo> <hi>)*nconds <body>)*n
+///                                 %plural{...}0; <mod> is 0 if none, and an
+///                                 option with no conditions always matches
+///   Diff   <arg> <arg> <body>*4   %diff{a $ b $ c|d}0,1
+/// \endcode
+struct DiagTextBytecodePrinter : DiagTextVisitor<DiagTextBytecodePrinter> {
+  using BaseTy = DiagTextVisitor<DiagTextBytecodePrinter>;
+  DiagTextBytecodePrinter(DiagnosticTextBuilder &Builder, std::string &Result)
+      : BaseTy(Builder), Result(Result) {}
+
+  std::string &getOutput() { return Result; }
+  SubstitutionCache<std::string> &getSubstitutionCache() {
+    return Builder.BytecodeSubstitutions;
+  }
+
+  void VisitMulti(MultiPiece *P) {
+    for (auto *Child : P->Pieces)
+      Visit(Child);
+  }
+
+  void VisitText(TextPiece *P) {
+    std::string Text;
+    Text.reserve(P->Text.size());
+    for (size_t I = 0, E = P->Text.size(); I != E; ++I) {
+      if (P->Text[I] == '%' && I + 1 != E && ispunct(P->Text[I + 1]))
+        ++I;
+      Text += P->Text[I];
+    }
+    if (Text.empty())
+      return;
+    addOp(DBO_Text);
+    addInt(Text.size());
+    Result += Text;
+  }
+
+  void VisitPlaceholder(PlaceholderPiece *P) {
+    switch (P->Kind) {
+    case MT_Placeholder:
+      addOp(DBO_Arg);
+      break;
+    case MT_Q:
+      addOp(DBO_Q);
+      break;
+    case MT_Ordinal:
+      addOp(DBO_Ordinal);
+      break;
+    case MT_ObjCClass:
+      addOp(DBO_ObjCClass);
+      break;
+    case MT_ObjCInstance:
+      addOp(DBO_ObjCInstance);
+      break;
+    default:
+      llvm_unreachable("not a placeholder modifier");
+    }
+    addInt(mapIndex(P->Index));
+  }
+
+  void VisitSelect(SelectPiece *P) {
+    if (P->ModKind == MT_S) {
+      addOp(DBO_S);
+      addInt(mapIndex(P->Index));
+      return;
+    }
+    addOp(DBO_Select);
+    addInt(mapIndex(P->Index));
+    addInt(P->Options.size());
+    for (auto *O : P->Options)
+      addBody(O);
+  }
+
+  void VisitPlural(PluralPiece *P) {
+    assert(P->Options.size() == P->OptionPrefixes.size());
+    addOp(DBO_Plural);
+    addInt(mapIndex(P->Index));
+    addInt(P->Options.size());
+    for (unsigned I = 0, End = P->Options.size(); I < End; ++I) {
+      addPluralConditions(cast<TextPiece>(P->OptionPrefixes[I])->Text);
+      addBody(P->Options[I]);
+    }
+  }
+
+  void VisitDiff(DiffPiece *P) {
+    addOp(DBO_Diff);
+    addInt(mapIndex(P->Indexes[0]));
+    addInt(mapIndex(P->Indexes[1]));
+    for (Piece *Part : P->Parts)
+      addBody(Part);
+  }
+
+private:
+  void addOp(DiagBytecodeOp Op) { Result += char(Op); }
+
+  void addInt(uint64_t Val) {
+    uint8_t Buf[16];
+    unsigned Len = encodeULEB128(Val, Buf);
+    Result.append(reinterpret_cast<const char *>(Buf), Len);
+  }
+
+  void addBody(Piece *P) {
+    std::string Body;
+    DiagTextBytecodePrinter Visitor{Builder, Body};
+    Visitor.ModifierMappings = ModifierMappings;
+    Visitor.Visit(P);
+    addInt(Body.size());
+    Result += Body;
+  }
+
+  /// Encode a %plural option prefix such as "1:", "[2,4]:", "%100=1,3:" or
+  /// ":" as a list of (modulus, low, high) conditions.
+  void addPluralConditions(StringRef Prefix) {
+    StringRef Conds = Prefix.drop_back(); // ':'
+    SmallVector<std::array<unsigned, 3>, 2> Parsed;
+    auto ParseNumber = [&]() {
+      unsigned Val;
+      if (Conds.consumeInteger(10, Val))
+        Builder.PrintFatalError("expected number in %plural condition '" +
+                                Prefix + "'");
+      return Val;
+    };
+    auto Expect = [&](StringRef Str) {
+      if (!Conds.consume_front(Str))
+        Builder.PrintFatalError("expected '" + Str +
+                                "' in %plural condition '" + Prefix + "'");
+    };
+    while (!Conds.empty()) {
+      unsigned Mod = 0;
+      if (Conds.consume_front("%")) {
+        Mod = ParseNumber();
+        Expect("=");
+      }
+      unsigned Lo, Hi;
+      if (Conds.consume_front("[")) {
+        Lo = ParseNumber();
+        Expect(",");
+        Hi = ParseNumber();
+        Expect("]");
+      } else {
+        Lo = Hi = ParseNumber();
+      }
+      Parsed.push_back({Mod, Lo, Hi});
+      if (!Conds.empty())
+        Expect(",");
+    }
+    addInt(Parsed.size());
+    for (const auto &Cond : Parsed)
+      for (unsigned Val : Cond)
+        addInt(Val);
+  }
+
+  std::string &Result;
+};
+
 int DiagnosticTextBuilder::DiagText::parseModifier(StringRef &Text) const {
   if (Text.empty() || !isdigit(Text[0]))
     Builder.PrintFatalError("expected modifier in diagnostic");
@@ -1015,7 +1290,7 @@ int DiagnosticTextBuilder::DiagText::parseModifier(StringRef &Text) const {
 
 Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
                                                       StopAt Stop) {
-  std::vector<Piece *> Parsed;
+  SmallVector<Piece *, 8> Parsed;
 
   constexpr llvm::StringLiteral StopSets[] = {"%", "%|}", "%|}$"};
   llvm::StringRef StopSet = StopSets[static_cast<int>(Stop)];
@@ -1069,12 +1344,13 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
       Builder.PrintFatalError("Unknown modifier type: " + Modifier);
     case MT_Select: {
       SelectPiece *Select = New<SelectPiece>(MT_Select);
+      SmallVector<Piece *, 4> Options;
       do {
         Text = Text.drop_front(); // '{' or '|'
-        Select->Options.push_back(
-            parseDiagText(Text, StopAt::PipeOrCloseBrace));
+        Options.push_back(parseDiagText(Text, StopAt::PipeOrCloseBrace));
         assert(!Text.empty() && "malformed %select");
       } while (Text.front() == '|');
+      Select->Options = copyArray<Piece *>(Options);
       ExpectAndConsume("}");
       Select->Index = parseModifier(Text);
       Parsed.push_back(Select);
@@ -1082,6 +1358,7 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
     }
     case MT_Plural: {
       PluralPiece *Plural = New<PluralPiece>();
+      SmallVector<Piece *, 4> OptionPrefixes, Options;
       do {
         Text = Text.drop_front(); // '{' or '|'
         size_t End = Text.find_first_of(":");
@@ -1089,13 +1366,14 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
           Builder.PrintFatalError("expected ':' while parsing %plural");
         ++End;
         assert(!Text.empty());
-        Plural->OptionPrefixes.push_back(
+        OptionPrefixes.push_back(
             New<TextPiece>(Text.slice(0, End), "diagtext"));
         Text = Text.slice(End, StringRef::npos);
-        Plural->Options.push_back(
-            parseDiagText(Text, StopAt::PipeOrCloseBrace));
+        Options.push_back(parseDiagText(Text, StopAt::PipeOrCloseBrace));
         assert(!Text.empty() && "malformed %plural");
       } while (Text.front() == '|');
+      Plural->OptionPrefixes = copyArray<Piece *>(OptionPrefixes);
+      Plural->Options = copyArray<Piece *>(Options);
       ExpectAndConsume("}");
       Plural->Index = parseModifier(Text);
       Parsed.push_back(Plural);
@@ -1107,14 +1385,15 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
       size_t NameSize = Text.find_first_of('}');
       assert(NameSize != size_t(-1) && "failed to find the end of the name");
       assert(NameSize != 0 && "empty name?");
-      Sub->Name = Text.substr(0, NameSize).str();
+      Sub->Name = Text.substr(0, NameSize);
       Text = Text.drop_front(NameSize);
       ExpectAndConsume("}");
+      SmallVector<int, 4> Modifiers;
       if (!Text.empty()) {
         while (true) {
           if (!isdigit(Text[0]))
             break;
-          Sub->Modifiers.push_back(parseModifier(Text));
+          Modifiers.push_back(parseModifier(Text));
           if (Text.empty() || Text[0] != ',')
             break;
           Text = Text.drop_front(); // ','
@@ -1122,6 +1401,7 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
                  "expected another modifier");
         }
       }
+      Sub->Modifiers = copyArray<int>(Modifiers);
       Parsed.push_back(Sub);
       continue;
     }
@@ -1144,8 +1424,8 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
     }
     case MT_S: {
       SelectPiece *Select = New<SelectPiece>(ModType);
-      Select->Options.push_back(New<TextPiece>(""));
-      Select->Options.push_back(New<TextPiece>("s", "diagtext"));
+      Piece *Options[] = {New<TextPiece>(""), New<TextPiece>("s", "diagtext")};
+      Select->Options = copyArray<Piece *>(Options);
       Select->Index = parseModifier(Text);
       Parsed.push_back(Select);
       continue;
@@ -1161,39 +1441,100 @@ Piece *DiagnosticTextBuilder::DiagText::parseDiagText(StringRef &Text,
     }
   }
 
-  return New<MultiPiece>(Parsed);
+  return New<MultiPiece>(copyArray<Piece *>(Parsed));
+}
+
+thread_local const Record *DiagnosticTextBuilder::EvaluatingRecord = nullptr;
+
+void DiagnosticTextBuilder::forEachDiag(
+    size_t N, function_ref<void(size_t, BumpPtrAllocator &)> Fn) const {
+  // Chunk the work so that each task amortizes its allocator over a batch of
+  // diagnostics rather than paying for a fresh slab per record.
+  const size_t ChunkSize = 64;
+  std::vector<size_t> ChunkStarts;
+  for (size_t I = 0; I < N; I += ChunkSize)
+    ChunkStarts.push_back(I);
+
+  auto RunChunk = [&](size_t Start) {
+    BumpPtrAllocator Scratch;
+    for (size_t I = Start, E = std::min(N, Start + ChunkSize); I != E; ++I) {
+      Fn(I, Scratch);
+      Scratch.Reset();
+    }
+  };
+
+  parallelForEach(ChunkStarts, RunChunk);
+}
+
+std::vector<std::string>
+DiagnosticTextBuilder::buildForDefinitions(ArrayRef<const Record *> Diags) {
+  std::vector<std::string> Result(Diags.size());
+  forEachDiag(Diags.size(), [&](size_t I, BumpPtrAllocator &Alloc) {
+    Result[I] = buildForDefinition(Diags[I], Alloc);
+  });
+  return Result;
+}
+
+std::vector<std::string>
+DiagnosticTextBuilder::buildBytecodes(ArrayRef<const Record *> Diags) {
+  std::vector<std::string> Result(Diags.size());
+  forEachDiag(Diags.size(), [&](size_t I, BumpPtrAllocator &Alloc) {
+    Result[I] = buildBytecode(Diags[I], Alloc);
+  });
+  return Result;
+}
+
+std::vector<std::vector<std::string>>
+DiagnosticTextBuilder::buildForDocumentations(
+    ArrayRef<std::pair<std::string, const Record *>> Diags) {
+  std::vector<std::vector<std::string>> Result(Diags.size());
+  forEachDiag(Diags.size(), [&](size_t I, BumpPtrAllocator &Alloc) {
+    Result[I] = buildForDocumentation(Diags[I].first, Diags[I].second, Alloc);
+  });
+  return Result;
 }
 
 std::vector<std::string>
 DiagnosticTextBuilder::buildForDocumentation(StringRef Severity,
-                                             const Record *R) {
+                                             const Record *R,
+                                             BumpPtrAllocator &Alloc) {
   EvaluatingRecordGuard Guard(&EvaluatingRecord, R);
   StringRef Text = R->getValueAsString("Text");
 
-  DiagText D(*this, Text);
-  TextPiece *Prefix = D.New<TextPiece>(Severity, Severity);
-  Prefix->Text += ": ";
-  auto *MP = dyn_cast<MultiPiece>(D.Root);
-  if (!MP) {
-    MP = D.New<MultiPiece>();
-    MP->Pieces.push_back(D.Root);
-    D.Root = MP;
-  }
-  MP->Pieces.insert(MP->Pieces.begin(), Prefix);
+  DiagText D(*this, Alloc, Text);
+  std::string PrefixText = (Severity + ": ").str();
+  TextPiece *Prefix = D.New<TextPiece>(PrefixText, Severity);
+  SmallVector<Piece *, 8> Pieces = {Prefix};
+  if (auto *MP = dyn_cast<MultiPiece>(D.Root))
+    Pieces.append(MP->Pieces.begin(), MP->Pieces.end());
+  else
+    Pieces.push_back(D.Root);
+  D.Root = D.New<MultiPiece>(D.copyArray<Piece *>(Pieces));
   std::vector<std::string> Result;
   DiagTextDocPrinter{*this, Result}.Visit(D.Root);
   return Result;
 }
 
-std::string DiagnosticTextBuilder::buildForDefinition(const Record *R) {
+std::string DiagnosticTextBuilder::buildForDefinition(const Record *R,
+                                                      BumpPtrAllocator &Alloc) {
   EvaluatingRecordGuard Guard(&EvaluatingRecord, R);
   StringRef Text = R->getValueAsString("Text");
-  DiagText D(*this, Text);
+  DiagText D(*this, Alloc, Text);
   std::string Result;
   DiagTextPrinter{*this, Result}.Visit(D.Root);
   return Result;
 }
 
+std::string DiagnosticTextBuilder::buildBytecode(const Record *R,
+                                                 BumpPtrAllocator &Alloc) {
+  EvaluatingRecordGuard Guard(&EvaluatingRecord, R);
+  StringRef Text = R->getValueAsString("Text");
+  DiagText D(*this, Alloc, Text);
+  std::string Result;
+  DiagTextBytecodePrinter{*this, Result}.Visit(D.Root);
+  return Result;
+}
+
 } // namespace
 
 //===----------------------------------------------------------------------===//
@@ -1213,19 +1554,66 @@ static bool isRemark(const Record &Diag) {
 }
 
 
+/// Emit the bytecode form of the text of \p Diags, along with the opcodes
+/// needed to interpret it.
+///
+/// \code
+/// #ifdef DIAG_BYTECODE_OP
+/// DIAG_BYTECODE_OP(Text, 1)
+/// #endif // DIAG_BYTECODE_OP
+///
+/// #ifdef DIAG_BYTECODE
+/// DIAG_BYTECODE(err_expected, "\001\011expected \002\000")
+/// #endif // DIAG_BYTECODE
+/// \endcode
+static void emitDiagBytecode(DiagnosticTextBuilder &DiagTextBuilder,
+                             ArrayRef<const Record *> Diags, raw_ostream &OS) {
+  OS << "\n#ifdef DIAG_BYTECODE_OP\n";
+  for (const auto &Op : DiagBytecodeOpNames)
+    OS << "DIAG_BYTECODE_OP(" << Op.second << ", " << unsigned(Op.first)
+       << ")\n";
+  OS << "#endif // DIAG_BYTECODE_OP\n\n";
+
+  std::vector<std::string> Bytecodes = DiagTextBuilder.buildBytecodes(Diags);
+  OS << "#ifdef DIAG_BYTECODE\n";
+  for (unsigned I = 0, E = Diags.size(); I != E; ++I) {
+    OS << "DIAG_BYTECODE(" << Diags[I]->getName() << ", \"";
+    OS.write_escaped(Bytecodes[I]) << "\")\n";
+  }
+  OS << "#endif // DIAG_BYTECODE\n";
+}
+
+/// Emit the guard that starts the numbering of \p Component's diagnostics.
+static void emitComponentStart(StringRef Component, raw_ostream &OS) {
+  std::string ComponentName = Component.upper();
+  OS << "#ifdef " << ComponentName << "START\n";
+  OS << "__" << ComponentName << "START = DIAG_START_" << ComponentName
+     << ",\n";
+  OS << "#undef " << ComponentName << "START\n";
+  OS << "#endif\n\n";
+}
+
 /// ClangDiagsDefsEmitter - The top-level class emits .def files containing
 /// declarations of Clang diagnostics.
-void clang::EmitClangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
-                               const std::string &Component) {
+///
+/// With \p AllComponents, the declarations of every component are
+/// emitted from a single run, each section matching what -clang-component
+/// would produce for that component. Every diagnostic must then have a
+/// component:
+///
+/// \code
+/// #ifdef DIAG_COMPONENT_SEMA
+/// #ifdef SEMASTART
+/// ...
+/// DIAG(err_expected, ...)
+/// #endif // DIAG_COMPONENT_SEMA
+/// \endcode
+static void emitClangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
+                               const std::string &Component,
+                               bool AllComponents, bool EmitBytecode) {
   // Write the #if guard
-  if (!Component.empty()) {
-    std::string ComponentName = StringRef(Component).upper();
-    OS << "#ifdef " << ComponentName << "START\n";
-    OS << "__" << ComponentName << "START = DIAG_START_" << ComponentName
-       << ",\n";
-    OS << "#undef " << ComponentName << "START\n";
-    OS << "#endif\n\n";
-  }
+  if (!Component.empty())
+    emitComponentStart(Component, OS);
 
   DiagnosticTextBuilder DiagTextBuilder(Records);
 
@@ -1245,6 +1633,10 @@ void clang::EmitClangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
   InferPedantic inferPedantic(DGParentMap, Diags, DiagGroups, DiagsInGroup);
   inferPedantic.compute(&DiagsInPedantic, (RecordVec*)nullptr);
 
+  // Check every diagnostic, and bucket the ones to emit by component.
+  std::map<std::string, std::vector<const Record *>> DiagsByComponent;
+  if (!AllComponents)
+    DiagsByComponent[Component];
   for (unsigned i = 0, e = Diags.size(); i != e; ++i) {
     const Record &R = *Diags[i];
 
@@ -1269,64 +1661,252 @@ void clang::EmitClangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
     }
 
     // Filter by component.
-    if (!Component.empty() && Component != R.getValueAsString("Component"))
-      continue;
+    StringRef DiagComponent = R.getValueAsString("Component");
+    if (AllComponents) {
+      // There is no DIAG_COMPONENT_ guard that could select these.
+      if (DiagComponent.empty())
+        PrintFatalError(R.getLoc(),
+                        "Diagnostic " + R.getName() +
+                            " has no component, which "
+                            "-clang-diags-all-components requires");
+      DiagsByComponent[std::string(DiagComponent)].push_back(&R);
+    } else if (Component.empty() || Component == DiagComponent) {
+      DiagsByComponent[Component].push_back(&R);
+    }
+  }
 
-    OS << "DIAG(" << R.getName() << ", ";
-    OS << R.getValueAsDef("Class")->getName();
-    OS << ", (unsigned)diag::Severity::"
-       << R.getValueAsDef("DefaultSeverity")->getValueAsString("Name");
-
-    // Description string.
-    OS << ", \"";
-    OS.write_escaped(DiagTextBuilder.buildForDefinition(&R)) << '"';
-
-    // Warning group associated with the diagnostic. This is stored as an index
-    // into the alphabetically sorted warning group table.
-    if (DefInit *DI = dyn_cast<DefInit>(R.getValueInit("Group"))) {
-      std::map<std::string, GroupInfo>::iterator I = DiagsInGroup.find(
-          std::string(DI->getDef()->getValueAsString("GroupName")));
-      assert(I != DiagsInGroup.end());
-      OS << ", " << I->second.IDNo;
-    } else if (DiagsInPedantic.count(&R)) {
-      std::map<std::string, GroupInfo>::iterator I =
-        DiagsInGroup.find("pedantic");
-      assert(I != DiagsInGroup.end() && "pedantic group not defined");
-      OS << ", " << I->second.IDNo;
-    } else {
-      OS << ", 0";
+  // Build the text of every diagnostic to emit up front; this is the only part
+  // of the per-diagnostic work that is independent across records.
+  std::vector<const Record *> EmittedDiags;
+  for (const auto &Bucket : DiagsByComponent)
+    EmittedDiags.insert(EmittedDiags.end(), Bucket.second.begin(),
+                        Bucket.second.end());
+  std::vector<std::string> DiagTexts =
+      DiagTextBuilder.buildForDefinitions(EmittedDiags);
+  auto NextDiagText = DiagTexts.begin();
+
+  for (const auto &Bucket : DiagsByComponent) {
+    std::string ComponentName = StringRef(Bucket.first).upper();
+    if (AllComponents) {
+      OS << "#ifdef DIAG_COMPONENT_" << ComponentName << "\n";
+      emitComponentStart(Bucket.first, OS);
     }
 
-    // SFINAE response.
-    OS << ", " << R.getValueAsDef("SFINAE")->getName();
+    for (const Record *D : Bucket.second) {
+      const Record &R = *D;
+
+      OS << "DIAG(" << R.getName() << ", ";
+      OS << R.getValueAsDef("Class")->getName();
+      OS << ", (unsigned)diag::Severity::"
+         << R.getValueAsDef("DefaultSeverity")->getValueAsString("Name");
+
+      // Description string.
+      OS << ", \"";
+      OS.write_escaped(*NextDiagText++) << '"';
+
+      // Warning group associated with the diagnostic. This is stored as an
+      // index into the alphabetically sorted warning group table.
+      if (DefInit *DI = dyn_cast<DefInit>(R.getValueInit("Group"))) {
+        std::map<std::string, GroupInfo>::iterator I = DiagsInGroup.find(
+            std::string(DI->getDef()->getValueAsString("GroupName")));
+        assert(I != DiagsInGroup.end());
+        OS << ", " << I->second.IDNo;
+      } else if (DiagsInPedantic.count(&R)) {
+        std::map<std::string, GroupInfo>::iterator I =
+          DiagsInGroup.find("pedantic");
+        assert(I != DiagsInGroup.end() && "pedantic group not defined");
+        OS << ", " << I->second.IDNo;
+      } else {
+        OS << ", 0";
+      }
 
-    // Default warning has no Werror bit.
-    if (R.getValueAsBit("WarningNoWerror"))
-      OS << ", true";
-    else
-      OS << ", false";
+      // SFINAE response.
+      OS << ", " << R.getValueAsDef("SFINAE")->getName();
 
-    if (R.getValueAsBit("ShowInSystemHeader"))
-      OS << ", true";
-    else
-      OS << ", false";
+      // Default warning has no Werror bit.
+      if (R.getValueAsBit("WarningNoWerror"))
+        OS << ", true";
+      else
+        OS << ", false";
 
-    if (R.getValueAsBit("ShowInSystemMacro"))
-      OS << ", true";
-    else
-      OS << ", false";
+      if (R.getValueAsBit("ShowInSystemHeader"))
+        OS << ", true";
+      else
+        OS << ", false";
 
-    if (R.getValueAsBit("Deferrable"))
-      OS << ", true";
-    else
-      OS << ", false";
+      if (R.getValueAsBit("ShowInSystemMacro"))
+        OS << ", true";
+      else
+        OS << ", false";
 
-    // Category number.
-    OS << ", " << CategoryIDs.getID(getDiagnosticCategory(&R, DGParentMap));
-    OS << ")\n";
+      if (R.getValueAsBit("Deferrable"))
+        OS << ", true";
+      else
+        OS << ", false";
+
+      // Category number.
+      OS << ", " << CategoryIDs.getID(getDiagnosticCategory(&R, DGParentMap));
+      OS << ")\n";
+    }
+
+    if (EmitBytecode)
+      emitDiagBytecode(DiagTextBuilder, Bucket.second, OS);
+
+    if (AllComponents)
+      OS << "#endif // DIAG_COMPONENT_" << ComponentName << "\n\n";
   }
 }
 
+void clang::EmitClangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
+                               const std::string &Component) {
+  emitClangDiagsDefs(Records, OS, Component, /*AllComponents=*/false,
+                     /*EmitBytecode=*/false);
+}
+
+/// Emit the declarations of EmitClangDiagsDefs, followed by the bytecode form
+/// of the text of the diagnostics; see emitDiagBytecode.
+void clang::EmitClangDiagsDefsBytecode(RecordKeeper &Records, raw_ostream &OS,
+                                       const std::string &Component) {
+  emitClangDiagsDefs(Records, OS, Component, /*AllComponents=*/false,
+                     /*EmitBytecode=*/true);
+}
+
+/// Emit the declarations of the diagnostics of every component, each in its
+/// own DIAG_COMPONENT_<NAME> section, followed by their bytecode if
+/// \p EmitBytecode is set.
+void clang::EmitClangAllDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
+                                  bool EmitBytecode) {
+  emitClangDiagsDefs(Records, OS, "", /*AllComponents=*/true, EmitBytecode);
+}
+
+//===----------------------------------------------------------------------===//
+// Perfect hash tables of names
+//===----------------------------------------------------------------------===//
+
+/// The hash function of the perfect hash tables. This must be kept in sync
+/// with the copy emitted by emitNameHash.
+static uint32_t hashName(StringRef Name, uint32_t Seed) {
+  uint32_t Hash = 2166136261u ^ Seed;
+  for (unsigned char C : Name) {
+    Hash ^= C;
+    Hash *= 16777619u;
+  }
+  Hash ^= Hash >> 16;
+  Hash *= 0x85ebca6bu;
+  Hash ^= Hash >> 13;
+  Hash *= 0xc2b2ae35u;
+  Hash ^= Hash >> 16;
+  return Hash;
+}
+
+/// Try to place every name in \p Names into a table of \p TableSize slots,
+/// picking a seed per bucket so that no two names collide. Returns false if
+/// some bucket has no such seed.
+static bool buildNameHash(ArrayRef<StringRef> Names, unsigned NumBuckets,
+                          unsigned TableSize, std::vector<uint16_t> &Seeds,
+                          std::vector<uint16_t> &Table) {
+  std::vector<std::vector<unsigned>> Buckets(NumBuckets);
+  for (unsigned I = 0, E = Names.size(); I != E; ++I)
+    Buckets[hashName(Names[I], 0) % NumBuckets].push_back(I);
+
+  // Place the largest buckets first, while the table is still mostly empty.
+  std::vector<unsigned> Order(NumBuckets);
+  std::iota(Order.begin(), Order.end(), 0);
+  llvm::stable_sort(Order, [&](unsigned LHS, unsigned RHS) {
+    return Buckets[LHS].size() > Buckets[RHS].size();
+  });
+
+  Seeds.assign(NumBuckets, 0);
+  Table.assign(TableSize, UINT16_MAX);
+  SmallVector<unsigned, 8> Slots;
+  for (unsigned B : Order) {
+    if (Buckets[B].empty())
+      break;
+    bool Placed = false;
+    for (uint32_t Seed = 0; Seed <= UINT16_MAX && !Placed; ++Seed) {
+      Slots.clear();
+      Placed = true;
+      for (unsigned I : Buckets[B]) {
+        unsigned Slot = hashName(Names[I], Seed) % TableSize;
+        if (Table[Slot] != UINT16_MAX || is_contained(Slots, Slot)) {
+          Placed = false;
+          break;
+        }
+        Slots.push_back(Slot);
+      }
+      if (Placed) {
+        Seeds[B] = Seed;
+        for (unsigned J = 0, E = Slots.size(); J != E; ++J)
+          Table[Slots[J]] = Buckets[B][J];
+      }
+    }
+    if (!Placed)
+      return false;
+  }
+  return true;
+}
+
+/// Emit a perfect hash table mapping each of \p Names to its index.
+///
+/// A name is hashed once with seed 0 to pick a bucket, and once more with the
+/// bucket's seed to pick a slot in the table. The slot holds the index of the
+/// only name that can hash there, or UINT16_MAX. Every emitted entity is named
+/// after \p Prefix:
+///
+/// \code
+///   static const unsigned <Prefix>HashBuckets = 2;
+///   static const unsigned <Prefix>HashSize = 3;
+///   static const uint16_t <Prefix>HashSeeds[] = {0, 3};
+///   static const uint16_t <Prefix>HashTable[] = {2, 0, 1};
+///   static inline uint32_t hash<Prefix>Name(const char *Name, size_t Len,
+///                                           uint32_t Seed);
+/// \endcode
+static void emitNameHash(StringRef Prefix, ArrayRef<StringRef> Names,
+                         raw_ostream &OS) {
+  if (Names.size() >= UINT16_MAX)
+    PrintFatalError("Too many names for the " + Prefix + " name hash");
+
+  // Aim for a minimal table; make it sparser only if no seeds can be found.
+  unsigned NumBuckets = std::max<unsigned>(1, (Names.size() + 1) / 2);
+  unsigned TableSize = std::max<unsigned>(1, Names.size());
+  std::vector<uint16_t> Seeds, Table;
+  while (!buildNameHash(Names, NumBuckets, TableSize, Seeds, Table))
+    TableSize += TableSize / 4 + 1;
+
+  OS << "static const unsigned " << Prefix << "HashBuckets = " << NumBuckets
+     << ";\n";
+  OS << "static const unsigned " << Prefix << "HashSize = " << TableSize
+     << ";\n\n";
+
+  auto EmitArray = [&](StringRef Name, ArrayRef<uint16_t> Elts) {
+    OS << "static const uint16_t " << Prefix << Name << "[] = {";
+    for (unsigned I = 0, E = Elts.size(); I != E; ++I) {
+      if (I % 12 == 0)
+        OS << "\n ";
+      OS << " " << Elts[I] << ",";
+    }
+    OS << "\n};\n\n";
+  };
+  EmitArray("HashSeeds", Seeds);
+  EmitArray("HashTable", Table);
+
+  std::string Decl = ("static inline uint32_t hash" + Prefix + "Name(").str();
+  OS << Decl << "const char *Name, size_t Len,\n"
+     << std::string(Decl.size(), ' ') << "uint32_t Seed) {\n"
+     << "  uint32_t Hash = 2166136261u ^ Seed;\n"
+     << "  for (size_t I = 0; I != Len; ++I) {\n"
+     << "    Hash ^= (unsigned char)Name[I];\n"
+     << "    Hash *= 16777619u;\n"
+     << "  }\n"
+     << "  Hash ^= Hash >> 16;\n"
+     << "  Hash *= 0x85ebca6bu;\n"
+     << "  Hash ^= Hash >> 13;\n"
+     << "  Hash *= 0xc2b2ae35u;\n"
+     << "  Hash ^= Hash >> 16;\n"
+     << "  return Hash;\n"
+     << "}\n\n";
+}
+
 //===----------------------------------------------------------------------===//
 // Warning Group Tables generation
 //===----------------------------------------------------------------------===//
@@ -1470,6 +2050,202 @@ static void emitAllDiagArrays(std::map<std::string, GroupInfo> &DiagsInGroup,
   OS << "#endif // GET_DIAG_ARRAYS\n\n";
 }
 
+/// Emit the transitive closure of each diagnostic group as a bitset.
+///
+/// Bit I of a group's bitset is set if the I-th entry of GroupedDiags, the
+/// list of every diagnostic reachable from some group, is in the group or in
+/// any of its subgroups (recursively). Bitsets are indexed by group ID, in the
+/// same order as the DIAG_ENTRY table.
+///
+/// A dense table would need a bitset over all of GroupedDiags per group, but
+/// most groups only reach a few words of it, since a group's own diagnostics
+/// are numbered together. So only the nonzero words are stored, each with its
+/// index in the bitset, and each group has a span of them:
+///
+/// \code
+/// #ifdef GET_DIAG_GROUP_BITSETS
+///   static const unsigned DiagGroupBitsetWords = 2;
+///   static const int16_t GroupedDiags[] = {
+///     diag::warn_pragma_message, diag::warn_abs_too_small, ...
+///   };
+///   static const uint64_t DiagGroupBitsetValues[] = {
+///     /* abi */ UINT64_C(0x0000000000000002),
+///     ...
+///   };
+///   static const uint16_t DiagGroupBitsetIndices[] = {
+///     /* abi */ 0,
+///     ...
+///   };
+///   static const uint32_t DiagGroupBitsetSpans[] = {
+///     /* abi */ 0,
+///     ...
+///     2345
+///   };
+/// #endif
+/// \endcode
+static void emitDiagGroupBitsets(std::map<std::string, GroupInfo> &DiagsInGroup,
+                                 RecordVec &DiagsInPedantic,
+                                 RecordVec &GroupsInPedantic,
+                                 raw_ostream &OS) {
+  // Number every diagnostic that is directly in some group.
+  DenseMap<const Record *, unsigned> DiagBits;
+  RecordVec GroupedDiags;
+  auto AddDiag = [&](const Record *Diag) {
+    if (DiagBits.try_emplace(Diag, GroupedDiags.size()).second)
+      GroupedDiags.push_back(Diag);
+  };
+  for (auto const &I : DiagsInGroup)
+    llvm::for_each(I.second.DiagsInGroup, AddDiag);
+  llvm::for_each(DiagsInPedantic, AddDiag);
+
+  // Compute the closures, memoized by group ID.
+  std::vector<BitVector> Closures(DiagsInGroup.size());
+  std::vector<bool> Computed(DiagsInGroup.size()), InProgress = Computed;
+  std::function<const BitVector &(const std::string &)> Compute =
+      [&](const std::string &GroupName) -> const BitVector & {
+    const GroupInfo &GI = DiagsInGroup.find(GroupName)->second;
+    BitVector &Closure = Closures[GI.IDNo];
+    if (Computed[GI.IDNo])
+      return Closure;
+    if (InProgress[GI.IDNo])
+      PrintFatalError("Diagnostic group '" + GroupName +
+                      "' is a subgroup of itself");
+    InProgress[GI.IDNo] = true;
+
+    BitVector Result(GroupedDiags.size());
+    for (const Record *Diag : GI.DiagsInGroup)
+      Result.set(DiagBits[Diag]);
+    for (const std::string &SubGroup : GI.SubGroups)
+      Result |= Compute(SubGroup);
+    if (GroupName == "pedantic") {
+      for (const Record *Diag : DiagsInPedantic)
+        Result.set(DiagBits[Diag]);
+      for (const Record *Group : GroupsInPedantic)
+        Result |= Compute(std::string(Group->getValueAsString("GroupName")));
+    }
+
+    Closure = std::move(Result);
+    Computed[GI.IDNo] = true;
+    return Closure;
+  };
+
+  const unsigned NumWords = std::max<unsigned>(
+      1, (GroupedDiags.size() + 63) / 64);
+  OS << "\n#ifdef GET_DIAG_GROUP_BITSETS\n";
+  OS << "static const unsigned DiagGroupBitsetWords = " << NumWords << ";\n\n";
+
+  OS << "static const int16_t GroupedDiags[] = {\n";
+  for (const Record *Diag : GroupedDiags)
+    OS << "  diag::" << Diag->getName() << ",\n";
+  // C++ has no empty arrays; a placeholder keeps the table well-formed when
+  // no diagnostic is in a group. It is never read, as no bit refers to it.
+  if (GroupedDiags.empty())
+    OS << "  0 // unused\n";
+  OS << "};\n\n";
+
+  // The nonzero words of each group's closure, in group ID order.
+  std::vector<std::pair<const std::string *, unsigned>> Spans;
+  std::vector<std::pair<uint64_t, unsigned>> Words;
+  for (auto const &I : DiagsInGroup) {
+    const BitVector &Closure = Compute(I.first);
+    Spans.push_back({&I.first, Words.size()});
+    for (unsigned W = 0; W != NumWords; ++W) {
+      uint64_t Word = 0;
+      for (unsigned B = 0; B != 64 && W * 64 + B < Closure.size(); ++B)
+        if (Closure.test(W * 64 + B))
+          Word |= uint64_t(1) << B;
+      if (Word)
+        Words.push_back({Word, W});
+    }
+  }
+
+  auto EmitWords = [&](StringRef Type, StringRef Name, auto EmitWord) {
+    OS << "static const " << Type << " " << Name << "[] = {\n";
+    for (unsigned G = 0, E = Spans.size(); G != E; ++G) {
+      unsigned End = G + 1 == E ? Words.size() : Spans[G + 1].second;
+      for (unsigned I = Spans[G].second; I != End; ++I) {
+        OS << "  ";
+        if (I == Spans[G].second)
+          OS << "/* " << *Spans[G].first << " */ ";
+        EmitWord(Words[I]);
+        OS << ",\n";
+      }
+    }
+    // Every span is empty when no group has a member, so this is never read.
+    if (Words.empty())
+      OS << "  0 // unused\n";
+    OS << "};\n\n";
+  };
+  EmitWords("uint64_t", "DiagGroupBitsetValues",
+            [&](const std::pair<uint64_t, unsigned> &Word) {
+              OS << "UINT64_C(" << format_hex(Word.first, 18) << ")";
+            });
+  EmitWords("uint16_t", "DiagGroupBitsetIndices",
+            [&](const std::pair<uint64_t, unsigned> &Word) {
+              OS << Word.second;
+            });
+
+  OS << "static const uint32_t DiagGroupBitsetSpans[] = {\n";
+  for (const auto &Span : Spans)
+    OS << "  /* " << *Span.first << " */ " << Span.second << ",\n";
+  OS << "  " << Words.size() << "\n";
+  OS << "};\n\n";
+
+  OS << "/// Add the diagnostics controlled by \\p Group to \\p Set, a bitset of\n"
+     << "/// DiagGroupBitsetWords words over GroupedDiags.\n"
+     << "static inline void addDiagGroupToBitset(unsigned Group, uint64_t "
+        "*Set) {\n"
+     << "  for (uint32_t I = DiagGroupBitsetSpans[Group],\n"
+     << "                E = DiagGroupBitsetSpans[Group + 1];\n"
+     << "       I != E; ++I)\n"
+     << "    Set[DiagGroupBitsetIndices[I]] |= DiagGroupBitsetValues[I];\n"
+     << "}\n\n"
+     << "/// Return true if GroupedDiags[Bit] is controlled by \\p Group.\n"
+     << "static inline bool isDiagInGroupBitset(unsigned Group, unsigned Bit) "
+        "{\n"
+     << "  for (uint32_t I = DiagGroupBitsetSpans[Group],\n"
+     << "                E = DiagGroupBitsetSpans[Group + 1];\n"
+     << "       I != E && DiagGroupBitsetIndices[I] <= Bit / 64; ++I)\n"
+     << "    if (DiagGroupBitsetIndices[I] == Bit / 64)\n"
+     << "      return (DiagGroupBitsetValues[I] >> (Bit % 64)) & 1;\n"
+     << "  return false;\n"
+     << "}\n";
+  OS << "#endif // GET_DIAG_GROUP_BITSETS\n\n";
+}
+
+/// Emit a perfect hash table from diagnostic group names to group IDs.
+///
+/// The table holds the ID of the only group that can have a given name, so a
+/// lookup costs two hashes and a single comparison against the name in
+/// DiagGroupNames.
+///
+/// \code
+/// #ifdef GET_DIAG_GROUP_NAME_HASH
+///   static const uint16_t DiagGroupHashTable[] = {2, 0, 1};
+///   ...
+///   static inline int lookupDiagGroupName(const char *Name, size_t Len);
+/// #endif
+/// \endcode
+static void emitDiagGroupNameHash(std::map<std::string, GroupInfo> &DiagsInGroup,
+                                  raw_ostream &OS) {
+  std::vector<StringRef> Names(DiagsInGroup.size());
+  for (auto const &I : DiagsInGroup)
+    Names[I.second.IDNo] = I.first;
+
+  OS << "\n#ifdef GET_DIAG_GROUP_NAME_HASH\n";
+  emitNameHash("DiagGroup", Names, OS);
+  OS << "/// Return the ID of the only diagnostic group that can be named \\p Name,\n"
+     << "/// or -1. The caller must still compare the group's name to \\p Name.\n"
+     << "static inline int lookupDiagGroupName(const char *Name, size_t Len) {\n"
+     << "  uint32_t Seed = DiagGroupHashSeeds[hashDiagGroupName(Name, Len, 0) %\n"
+     << "                                     DiagGroupHashBuckets];\n"
+     << "  uint16_t ID = DiagGroupHashTable[hashDiagGroupName(Name, Len, Seed) %\n"
+     << "                                   DiagGroupHashSize];\n"
+     << "  return ID == UINT16_MAX ? -1 : ID;\n"
+     << "}\n";
+  OS << "#endif // GET_DIAG_GROUP_NAME_HASH\n\n";
+}
+
 /// Emit diagnostic table.
 ///
 /// The table is sorted by the name of the diagnostic group. Each element
@@ -1576,7 +2352,12 @@ static void emitCategoryTable(RecordKeeper &Records, raw_ostream &OS) {
   OS << "#endif // GET_CATEGORY_TABLE\n\n";
 }
 
-void clang::EmitClangDiagGroups(RecordKeeper &Records, raw_ostream &OS) {
+/// Collect the diagnostic groups of \p Records, along with the diagnostics
+/// and groups that are implicitly in "pedantic".
+static void computeDiagGroups(RecordKeeper &Records,
+                              std::map<std::string, GroupInfo> &DiagsInGroup,
+                              RecordVec &DiagsInPedantic,
+                              RecordVec &GroupsInPedantic) {
   // Compute a mapping from a DiagGroup to all of its parents.
   DiagGroupParentMap DGParentMap(Records);
 
@@ -1585,16 +2366,20 @@ void clang::EmitClangDiagGroups(RecordKeeper &Records, raw_ostream &OS) {
   std::vector<Record *> DiagGroups =
       Records.getAllDerivedDefinitions("DiagGroup");
 
-  std::map<std::string, GroupInfo> DiagsInGroup;
   groupDiagnostics(Diags, DiagGroups, DiagsInGroup);
 
   // All extensions are implicitly in the "pedantic" group.  Record the
   // implicit set of groups in the "pedantic" group, and use this information
   // later when emitting the group information for Pedantic.
-  RecordVec DiagsInPedantic;
-  RecordVec GroupsInPedantic;
   InferPedantic inferPedantic(DGParentMap, Diags, DiagGroups, DiagsInGroup);
   inferPedantic.compute(&DiagsInPedantic, &GroupsInPedantic);
+}
+
+void clang::EmitClangDiagGroups(RecordKeeper &Records, raw_ostream &OS) {
+  std::map<std::string, GroupInfo> DiagsInGroup;
+  RecordVec DiagsInPedantic;
+  RecordVec GroupsInPedantic;
+  computeDiagGroups(Records, DiagsInGroup, DiagsInPedantic, GroupsInPedantic);
 
   StringToOffsetTable GroupNames;
   for (std::map<std::string, GroupInfo>::const_iterator
@@ -1613,42 +2398,107 @@ void clang::EmitClangDiagGroups(RecordKeeper &Records, raw_ostream &OS) {
   emitCategoryTable(Records, OS);
 }
 
+/// Emit the GET_DIAG_GROUP_BITSETS section for the groups that
+/// EmitClangDiagGroups numbers; see emitDiagGroupBitsets.
+void clang::EmitClangDiagGroupBitsets(RecordKeeper &Records,
+                                      raw_ostream &OS) {
+  std::map<std::string, GroupInfo> DiagsInGroup;
+  RecordVec DiagsInPedantic;
+  RecordVec GroupsInPedantic;
+  computeDiagGroups(Records, DiagsInGroup, DiagsInPedantic, GroupsInPedantic);
+  emitDiagGroupBitsets(DiagsInGroup, DiagsInPedantic, GroupsInPedantic, OS);
+}
+
+/// Emit the GET_DIAG_GROUP_NAME_HASH section for the groups that
+/// EmitClangDiagGroups numbers; see emitDiagGroupNameHash.
+void clang::EmitClangDiagGroupNameHash(RecordKeeper &Records,
+                                       raw_ostream &OS) {
+  std::map<std::string, GroupInfo> DiagsInGroup;
+  RecordVec DiagsInPedantic;
+  RecordVec GroupsInPedantic;
+  computeDiagGroups(Records, DiagsInGroup, DiagsInPedantic, GroupsInPedantic);
+  emitDiagGroupNameHash(DiagsInGroup, OS);
+}
+
 //===----------------------------------------------------------------------===//
 // Diagnostic name index generation
 //===----------------------------------------------------------------------===//
 
-namespace {
-struct RecordIndexElement
-{
-  RecordIndexElement() {}
-  explicit RecordIndexElement(Record const &R)
-      : Name(std::string(R.getName())) {}
-
-  std::string Name;
-};
-} // end anonymous namespace.
-
+/// Emit the sorted list of diagnostic names, followed by a table that looks
+/// up a diagnostic ID by name.
+///
+/// The names are packed into a single string, and a perfect hash over them
+/// picks the only table entry that can match a given name:
+///
+/// \code
+/// #ifdef GET_DIAG_NAME_TABLE
+///   static const char DiagNames[] = "err_foowarn_bar";
+///   static const struct {
+///     uint32_t NameOffset;
+///     uint16_t NameLength;
+///     unsigned DiagID;
+///   } DiagNameTable[] = {
+///     {0, 7, diag::err_foo},
+///     {7, 8, diag::warn_bar},
+///   };
+///   ...
+///   static inline int lookupDiagName(const char *Name, size_t Len);
+/// #endif
+/// \endcode
 void clang::EmitClangDiagsIndexName(RecordKeeper &Records, raw_ostream &OS) {
   const std::vector<Record*> &Diags =
     Records.getAllDerivedDefinitions("Diagnostic");
 
-  std::vector<RecordIndexElement> Index;
+  std::vector<StringRef> Index;
   Index.reserve(Diags.size());
-  for (unsigned i = 0, e = Diags.size(); i != e; ++i) {
-    const Record &R = *(Diags[i]);
-    Index.push_back(RecordIndexElement(R));
+  for (const Record *R : Diags)
+    Index.push_back(R->getName());
+  llvm::sort(Index);
+
+  for (StringRef Name : Index)
+    OS << "DIAG_NAME_INDEX(" << Name << ")\n";
+
+  StringToOffsetTable Names;
+  std::vector<unsigned> Offsets;
+  Offsets.reserve(Index.size());
+  for (StringRef Name : Index) {
+    if (Name.size() > UINT16_MAX)
+      PrintFatalError("Diagnostic name '" + Name + "' is too long");
+    Offsets.push_back(Names.GetOrAddStringOffset(Name, false));
   }
 
-  llvm::sort(Index,
-             [](const RecordIndexElement &Lhs, const RecordIndexElement &Rhs) {
-               return Lhs.Name < Rhs.Name;
-             });
+  OS << "\n#ifdef GET_DIAG_NAME_TABLE\n";
+  OS << "static const char DiagNames[] = {\n";
+  Names.EmitString(OS);
+  OS << "};\n\n";
 
-  for (unsigned i = 0, e = Index.size(); i != e; ++i) {
-    const RecordIndexElement &R = Index[i];
+  OS << "static const struct {\n"
+     << "  uint32_t NameOffset;\n"
+     << "  uint16_t NameLength;\n"
+     << "  unsigned DiagID;\n"
+     << "} DiagNameTable[] = {\n";
+  for (unsigned I = 0, E = Index.size(); I != E; ++I)
+    OS << "  {" << Offsets[I] << ", " << Index[I].size() << ", diag::"
+       << Index[I] << "},\n";
+  OS << "};\n\n";
 
-    OS << "DIAG_NAME_INDEX(" << R.Name << ")\n";
-  }
+  emitNameHash("Diag", Index, OS);
+  OS << "/// Return the index in DiagNameTable of the diagnostic named \\p Name,\n"
+     << "/// or -1 if there is none.\n"
+     << "static inline int lookupDiagName(const char *Name, size_t Len) {\n"
+     << "  uint32_t Seed = DiagHashSeeds[hashDiagName(Name, Len, 0) %\n"
+     << "                                DiagHashBuckets];\n"
+     << "  uint16_t I = DiagHashTable[hashDiagName(Name, Len, Seed) %\n"
+     << "                             DiagHashSize];\n"
+     << "  if (I == UINT16_MAX || DiagNameTable[I].NameLength != Len)\n"
+     << "    return -1;\n"
+     << "  const char *Candidate = DiagNames + DiagNameTable[I].NameOffset;\n"
+     << "  for (size_t J = 0; J != Len; ++J)\n"
+     << "    if (Candidate[J] != Name[J])\n"
+     << "      return -1;\n"
+     << "  return I;\n"
+     << "}\n";
+  OS << "#endif // GET_DIAG_NAME_TABLE\n";
 }
 
 //===----------------------------------------------------------------------===//
@@ -1658,59 +2508,185 @@ void clang::EmitClangDiagsIndexName(RecordKeeper &Records, raw_ostream &OS) {
 namespace docs {
 namespace {
 
-bool isRemarkGroup(const Record *DiagGroup,
-                   const std::map<std::string, GroupInfo> &DiagsInGroup) {
-  bool AnyRemarks = false, AnyNonRemarks = false;
-
-  std::function<void(StringRef)> Visit = [&](StringRef GroupName) {
-    auto &GroupInfo = DiagsInGroup.find(std::string(GroupName))->second;
-    for (const Record *Diag : GroupInfo.DiagsInGroup)
-      (isRemark(*Diag) ? AnyRemarks : AnyNonRemarks) = true;
-    for (const auto &Name : GroupInfo.SubGroups)
-      Visit(Name);
-  };
-  Visit(DiagGroup->getValueAsString("GroupName"));
-
-  if (AnyRemarks && AnyNonRemarks)
-    PrintFatalError(
-        DiagGroup->getLoc(),
-        "Diagnostic group contains both remark and non-remark diagnostics");
-  return AnyRemarks;
-}
-
 std::string getDefaultSeverity(const Record *Diag) {
   return std::string(
       Diag->getValueAsDef("DefaultSeverity")->getValueAsString("Name"));
 }
 
-std::set<std::string>
-getDefaultSeverities(const Record *DiagGroup,
-                     const std::map<std::string, GroupInfo> &DiagsInGroup) {
-  std::set<std::string> States;
+/// The default severities of the diagnostics in each group and all of its
+/// subgroups, and whether they are remarks, computed once per group.
+class GroupSeverities {
+  struct Info {
+    bool AnyRemarks = false, AnyNonRemarks = false;
+    std::set<std::string> DefaultSeverities;
+  };
+
+  const std::map<std::string, GroupInfo> &DiagsInGroup;
+  std::map<std::string, Info> Infos;
+
+  const Info &get(StringRef GroupName) {
+    auto It = Infos.find(std::string(GroupName));
+    if (It != Infos.end())
+      return It->second;
 
-  std::function<void(StringRef)> Visit = [&](StringRef GroupName) {
+    Info Result;
     auto &GroupInfo = DiagsInGroup.find(std::string(GroupName))->second;
-    for (const Record *Diag : GroupInfo.DiagsInGroup)
-      States.insert(getDefaultSeverity(Diag));
-    for (const auto &Name : GroupInfo.SubGroups)
-      Visit(Name);
-  };
-  Visit(DiagGroup->getValueAsString("GroupName"));
-  return States;
-}
+    for (const Record *Diag : GroupInfo.DiagsInGroup) {
+      (isRemark(*Diag) ? Result.AnyRemarks : Result.AnyNonRemarks) = true;
+      Result.DefaultSeverities.insert(getDefaultSeverity(Diag));
+    }
+    for (const auto &Name : GroupInfo.SubGroups) {
+      const Info &Sub = get(Name);
+      Result.AnyRemarks |= Sub.AnyRemarks;
+      Result.AnyNonRemarks |= Sub.AnyNonRemarks;
+      Result.DefaultSeverities.insert(Sub.DefaultSeverities.begin(),
+                                      Sub.DefaultSeverities.end());
+    }
+    return Infos[std::string(GroupName)] = std::move(Result);
+  }
+
+public:
+  GroupSeverities(const std::map<std::string, GroupInfo> &DiagsInGroup)
+      : DiagsInGroup(DiagsInGroup) {}
+
+  bool isRemarkGroup(const Record *DiagGroup) {
+    const Info &I = get(DiagGroup->getValueAsString("GroupName"));
+    if (I.AnyRemarks && I.AnyNonRemarks)
+      PrintFatalError(
+          DiagGroup->getLoc(),
+          "Diagnostic group contains both remark and non-remark diagnostics");
+    return I.AnyRemarks;
+  }
+
+  const std::set<std::string> &getDefaultSeverities(const Record *DiagGroup) {
+    return get(DiagGroup->getValueAsString("GroupName")).DefaultSeverities;
+  }
+};
+
+/// An on-disk cache of rendered group sections, keyed by a hash of everything
+/// that goes into a section. Disabled if no directory is given.
+class SectionCache {
+  std::string Dir;
+  // The generator and the substitutions can change the text of any section,
+  // so they are part of every key.
+  std::string CommonHash;
+
+  std::string getPath(StringRef Key) const {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Key + ".rst");
+    return std::string(Path.str());
+  }
+
+public:
+  SectionCache(StringRef Dir, RecordKeeper &Records) : Dir(Dir) {
+    if (Dir.empty())
+      return;
+    if (std::error_code EC = sys::fs::create_directories(Dir))
+      PrintFatalError("cannot create '" + Dir + "': " + EC.message());
+
+    // Identify the generator by its version and by the binary itself, so that
+    // sections rendered by any other build of it are never reused. Without a
+    // way to tell, the cache is not used at all.
+    static int StaticSymbol;
+    std::string Exe = sys::fs::getMainExecutable("", &StaticSymbol);
+    sys::fs::file_status Status;
+    if (Exe.empty() || sys::fs::status(Exe, Status)) {
+      this->Dir.clear();
+      return;
+    }
+
+    MD5 Hash;
+    auto AddPart = [&](StringRef Part) {
+      Hash.update(Part);
+      Hash.update(StringRef("\0", 1));
+    };
+    AddPart(LLVM_VERSION_STRING);
+    AddPart(Exe);
+    AddPart(utostr(Status.getSize()));
+    sys::TimePoint<> ModTime = Status.getLastModificationTime();
+    AddPart(utostr(ModTime.time_since_epoch().count()));
+    for (const Record *S : Records.getAllDerivedDefinitions("TextSubstitution")) {
+      Hash.update(S->getName());
+      AddPart(S->getValueAsString("Substitution"));
+    }
+    MD5::MD5Result Result;
+    Hash.final(Result);
+    CommonHash = std::string(Result.digest().str());
+  }
+
+  bool isEnabled() const { return !Dir.empty(); }
+
+  /// Compute the key of a section from its inputs.
+  std::string getKey(ArrayRef<std::string> Inputs) const {
+    MD5 Hash;
+    Hash.update(CommonHash);
+    for (StringRef Input : Inputs) {
+      Hash.update(Input);
+      Hash.update(StringRef("\0", 1));
+    }
+    MD5::MD5Result Result;
+    Hash.final(Result);
+    return std::string(Result.digest().str());
+  }
+
+  Optional<std::string> lookup(StringRef Key) const {
+    auto Buffer = MemoryBuffer::getFile(getPath(Key));
+    if (!Buffer)
+      return None;
+    return std::string((*Buffer)->getBuffer());
+  }
+
+  /// Store a section. Failures are ignored; the section will be rendered again
+  /// next time. Each writer uses its own temporary file, so runs sharing the
+  /// cache never see each other's partly written entries.
+  void store(StringRef Key, StringRef Section) const {
+    std::string Path = getPath(Key);
+    Expected<sys::fs::TempFile> Temp =
+        sys::fs::TempFile::create(Path + "-%%%%%%%%.tmp");
+    if (!Temp) {
+      consumeError(Temp.takeError());
+      return;
+    }
+    bool Failed;
+    {
+      raw_fd_ostream Out(Temp->FD, /*shouldClose=*/false);
+      Out << Section;
+      Out.flush();
+      Failed = Out.has_error();
+      Out.clear_error();
+    }
+    if (Failed)
+      consumeError(Temp->discard());
+    else
+      consumeError(Temp->keep(Path));
+  }
+};
 
 void writeHeader(StringRef Str, raw_ostream &OS, char Kind = '-') {
   OS << Str << "\n" << std::string(Str.size(), Kind) << "\n";
 }
 
-void writeDiagnosticText(DiagnosticTextBuilder &Builder, const Record *R,
-                         StringRef Role, raw_ostream &OS) {
-  StringRef Text = R->getValueAsString("Text");
-  if (Text == "%0")
+/// Return whether the text of \p R is rendered in the documentation, as
+/// opposed to being entirely supplied by the caller.
+bool hasDocumentedText(const Record *R) {
+  return R->getValueAsString("Text") != "%0";
+}
+
+/// Return the role used to render \p Diag's text in the documentation.
+std::string getDocumentationRole(const Record *Diag, bool IsRemarkGroup) {
+  auto Severity = getDefaultSeverity(Diag);
+  Severity[0] = tolower(Severity[0]);
+  if (Severity == "ignored")
+    Severity = IsRemarkGroup ? "remark" : "warning";
+  return Severity;
+}
+
+void writeDiagnosticText(const Record *R, ArrayRef<std::string> Lines,
+                         raw_ostream &OS) {
+  if (!hasDocumentedText(R))
     OS << "The text of this diagnostic is not controlled by Clang.\n\n";
   else {
-    std::vector<std::string> Out = Builder.buildForDocumentation(Role, R);
-    for (auto &Line : Out)
+    for (auto &Line : Lines)
       OS << Line << "\n";
     OS << "\n";
   }
@@ -1719,7 +2695,8 @@ void writeDiagnosticText(DiagnosticTextBuilder &Builder, const Record *R,
 }  // namespace
 }  // namespace docs
 
-void clang::EmitClangDiagDocs(RecordKeeper &Records, raw_ostream &OS) {
+static void emitClangDiagDocs(RecordKeeper &Records, raw_ostream &OS,
+                              StringRef CacheDir) {
   using namespace docs;
 
   // Get the documentation introduction paragraph.
@@ -1768,11 +2745,84 @@ void clang::EmitClangDiagDocs(RecordKeeper &Records, raw_ostream &OS) {
           std::string(Group->getValueAsString("GroupName")));
   }
 
+  for (auto &Group : DiagsInGroup)
+    llvm::sort(Group.second.SubGroups);
+
+  GroupSeverities Severities(DiagsInGroup);
+  SectionCache Cache(CacheDir, Records);
+
+  // Work out which group sections need to be rendered, and build the text of
+  // their diagnostics up front, in the order the loop below writes them out.
+  struct GroupSection {
+    bool IsRemarkGroup;
+    std::string Key;
+    Optional<std::string> Cached;
+  };
+  std::vector<GroupSection> Sections;
+  std::vector<std::pair<std::string, const Record *>> DocumentedDiags;
+  for (const Record *G : DiagGroups) {
+    GroupSection Section;
+    Section.IsRemarkGroup = Severities.isRemarkGroup(G);
+    auto &GroupInfo =
+        DiagsInGroup[std::string(G->getValueAsString("GroupName"))];
+
+    std::vector<std::pair<std::string, const Record *>> GroupDiags;
+    for (const Record *D : GroupInfo.DiagsInGroup)
+      if (hasDocumentedText(D))
+        GroupDiags.emplace_back(getDocumentationRole(D, Section.IsRemarkGroup),
+                                D);
+
+    if (Cache.isEnabled()) {
+      // Each list is preceded by its length, and each diagnostic contributes
+      // its name, text and role (empty if it isn't documented), so different
+      // sections can't produce the same inputs.
+      std::vector<std::string> Inputs = {
+          std::string(G->getValueAsString("GroupName")),
+          Section.IsRemarkGroup ? "R" : "W",
+          std::string(G->getValueAsString("Documentation"))};
+      const auto &DefaultSeverities = Severities.getDefaultSeverities(G);
+      Inputs.push_back(utostr(DefaultSeverities.size()));
+      Inputs.insert(Inputs.end(), DefaultSeverities.begin(),
+                    DefaultSeverities.end());
+      Inputs.push_back(utostr(GroupInfo.SubGroups.size()));
+      Inputs.insert(Inputs.end(), GroupInfo.SubGroups.begin(),
+                    GroupInfo.SubGroups.end());
+      Inputs.push_back(utostr(GroupInfo.DiagsInGroup.size()));
+      auto NextDocumented = GroupDiags.begin();
+      for (const Record *D : GroupInfo.DiagsInGroup) {
+        Inputs.push_back(std::string(D->getName()));
+        Inputs.push_back(std::string(D->getValueAsString("Text")));
+        if (NextDocumented != GroupDiags.end() && NextDocumented->second == D)
+          Inputs.push_back((NextDocumented++)->first);
+        else
+          Inputs.push_back("");
+      }
+      Section.Key = Cache.getKey(Inputs);
+      Section.Cached = Cache.lookup(Section.Key);
+    }
+
+    if (!Section.Cached)
+      DocumentedDiags.insert(DocumentedDiags.end(), GroupDiags.begin(),
+                             GroupDiags.end());
+    Sections.push_back(std::move(Section));
+  }
+  std::vector<std::vector<std::string>> DiagTexts =
+      Builder.buildForDocumentations(DocumentedDiags);
+  auto NextDiagText = DiagTexts.begin();
+
   // FIXME: Write diagnostic categories and link to diagnostic groups in each.
 
   // Write out the diagnostic groups.
-  for (const Record *G : DiagGroups) {
-    bool IsRemarkGroup = isRemarkGroup(G, DiagsInGroup);
+  for (unsigned I = 0, E = DiagGroups.size(); I != E; ++I) {
+    if (Sections[I].Cached) {
+      OS << *Sections[I].Cached;
+      continue;
+    }
+
+    std::string Section;
+    raw_string_ostream SOS(Section);
+    const Record *G = DiagGroups[I];
+    bool IsRemarkGroup = Sections[I].IsRemarkGroup;
     auto &GroupInfo =
         DiagsInGroup[std::string(G->getValueAsString("GroupName"))];
     bool IsSynonym = GroupInfo.DiagsInGroup.empty() &&
@@ -1780,63 +2830,76 @@ void clang::EmitClangDiagDocs(RecordKeeper &Records, raw_ostream &OS) {
 
     writeHeader(((IsRemarkGroup ? "-R" : "-W") +
                     G->getValueAsString("GroupName")).str(),
-                OS);
+                SOS);
 
     if (!IsSynonym) {
       // FIXME: Ideally, all the diagnostics in a group should have the same
       // default state, but that is not currently the case.
-      auto DefaultSeverities = getDefaultSeverities(G, DiagsInGroup);
+      const auto &DefaultSeverities = Severities.getDefaultSeverities(G);
       if (!DefaultSeverities.empty() && !DefaultSeverities.count("Ignored")) {
         bool AnyNonErrors = DefaultSeverities.count("Warning") ||
                             DefaultSeverities.count("Remark");
         if (!AnyNonErrors)
-          OS << "This diagnostic is an error by default, but the flag ``-Wno-"
-             << G->getValueAsString("GroupName") << "`` can be used to disable "
-             << "the error.\n\n";
+          SOS << "This diagnostic is an error by default, but the flag ``-Wno-"
+              << G->getValueAsString("GroupName")
+              << "`` can be used to disable the error.\n\n";
         else
-          OS << "This diagnostic is enabled by default.\n\n";
+          SOS << "This diagnostic is enabled by default.\n\n";
       } else if (DefaultSeverities.size() > 1) {
-        OS << "Some of the diagnostics controlled by this flag are enabled "
-           << "by default.\n\n";
+        SOS << "Some of the diagnostics controlled by this flag are enabled "
+            << "by default.\n\n";
       }
     }
 
     if (!GroupInfo.SubGroups.empty()) {
       if (IsSynonym)
-        OS << "Synonym for ";
+        SOS << "Synonym for ";
       else if (GroupInfo.DiagsInGroup.empty())
-        OS << "Controls ";
+        SOS << "Controls ";
       else
-        OS << "Also controls ";
+        SOS << "Also controls ";
 
       bool First = true;
-      llvm::sort(GroupInfo.SubGroups);
       for (const auto &Name : GroupInfo.SubGroups) {
-        if (!First) OS << ", ";
-        OS << "`" << (IsRemarkGroup ? "-R" : "-W") << Name << "`_";
+        if (!First) SOS << ", ";
+        SOS << "`" << (IsRemarkGroup ? "-R" : "-W") << Name << "`_";
         First = false;
       }
-      OS << ".\n\n";
+      SOS << ".\n\n";
     }
 
     if (!GroupInfo.DiagsInGroup.empty()) {
-      OS << "**Diagnostic text:**\n\n";
+      SOS << "**Diagnostic text:**\n\n";
       for (const Record *D : GroupInfo.DiagsInGroup) {
-        auto Severity = getDefaultSeverity(D);
-        Severity[0] = tolower(Severity[0]);
-        if (Severity == "ignored")
-          Severity = IsRemarkGroup ? "remark" : "warning";
-
-        writeDiagnosticText(Builder, D, Severity, OS);
+        ArrayRef<std::string> Lines;
+        if (hasDocumentedText(D))
+          Lines = *NextDiagText++;
+        writeDiagnosticText(D, Lines, SOS);
       }
     }
 
     auto Doc = G->getValueAsString("Documentation");
     if (!Doc.empty())
-      OS << Doc;
+      SOS << Doc;
     else if (GroupInfo.SubGroups.empty() && GroupInfo.DiagsInGroup.empty())
-      OS << "This diagnostic flag exists for GCC compatibility, and has no "
-            "effect in Clang.\n";
-    OS << "\n";
+      SOS << "This diagnostic flag exists for GCC compatibility, and has no "
+             "effect in Clang.\n";
+    SOS << "\n";
+
+    OS << SOS.str();
+    if (Cache.isEnabled())
+      Cache.store(Sections[I].Key, Section);
   }
 }
+
+void clang::EmitClangDiagDocs(RecordKeeper &Records, raw_ostream &OS) {
+  emitClangDiagDocs(Records, OS, "");
+}
+
+/// Emit the same documentation as EmitClangDiagDocs, reusing the sections of
+/// unchanged groups rendered into \p CacheDir by earlier runs. Entries are
+/// never removed from \p CacheDir.
+void clang::EmitClangDiagDocsCached(RecordKeeper &Records, raw_ostream &OS,
+                                    const std::string &CacheDir) {
+  emitClangDiagDocs(Records, OS, CacheDir);
+}
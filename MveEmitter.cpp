@@ -59,6 +59,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Casting.h"
@@ -69,7 +73,6 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <list>
 #include <map>
 #include <memory>
 #include <set>
@@ -133,11 +136,16 @@ public:
 private:
   const TypeKind TKind;
 
+  // Index of this type in the type arena of the EmitterBase that made it.
+  unsigned Handle = 0;
+  friend class EmitterBase;
+
 protected:
   Type(TypeKind K) : TKind(K) {}
 
 public:
   TypeKind typeKind() const { return TKind; }
+  unsigned handle() const { return Handle; }
   virtual ~Type() = default;
   virtual bool requiresFloat() const = 0;
   virtual bool requiresMVE() const = 0;
@@ -360,8 +368,8 @@ public:
 };
 
 // -----------------------------------------------------------------------------
-// Class to facilitate merging together the code generation for many intrinsics
-// by means of varying a few constant or type parameters.
+// Classes to facilitate merging together the code generation for many
+// intrinsics by means of varying a few constant or type parameters.
 //
 // Most obviously, the intrinsics in a single parametrised family will have
 // code generation sequences that only differ in a type or two, e.g. vaddq_s8
@@ -373,70 +381,90 @@ public:
 // the same way. And others might differ only in some other kind of constant,
 // such as a lane index.
 //
-// So, when we generate the IR-building code for all these intrinsics, we keep
-// track of every value that could possibly be pulled out of the code and
-// stored ahead of time in a local variable. Then we group together intrinsics
-// by textual equivalence of the code that would result if _all_ those
-// parameters were stored in local variables. That gives us maximal sets that
-// can be implemented by a single piece of IR-building code by changing
-// parameter values ahead of time.
+// So, before we generate any code, we make a single walk over each
+// intrinsic's graph of Result objects (see below) and record its 'shape' in a
+// CodeGenShape. Every value that could possibly be pulled out of the code and
+// stored ahead of time in a local variable goes into a numbered parameter
+// slot, and only the slot's type becomes part of the shape. Intrinsics with
+// the same shape can be implemented by a single piece of IR-building code by
+// changing parameter values ahead of time.
 //
-// After we've done that, we do a second pass in which we only allocate _some_
-// of the parameters into local variables, by tracking which ones have the same
-// values as each other (so that a single variable can be reused) and which
-// ones are the same across the whole set (so that no variable is needed at
-// all).
+// Within each such group we then decide which slots really need a parameter
+// variable, by tracking which ones have the same values as each other (so
+// that a single variable can be reused) and which ones are the same across
+// the whole group (so that no variable is needed at all). Code is generated
+// only once per group, from the list of Results recorded in the shape, with
+// each slot either turned into a parameter variable or written inline.
 //
-// Hence the class below. Its allocParam method is invoked during code
-// generation by every method of a Result subclass (see below) that wants to
-// give it the opportunity to pull something out into a switchable parameter.
-// It returns a variable name for the parameter, or (if it's being used in the
-// second pass once we've decided that some parameters don't need to be stored
-// in variables after all) it might just return the input expression unchanged.
+// The shape is kept as two structural keys. 'Layout' describes the sequence
+// of operations and parameter slots with the data flow between them left out,
+// which is what decides the parameter variables for a group; 'Wiring' records
+// which earlier Result each operand refers to. Intrinsics whose layouts match
+// but whose wiring differs get the same parameter variables, but separate
+// pieces of code.
+
+struct CodeGenShape {
+  FoldingSetNodeID Layout;
+  FoldingSetNodeID Wiring;
+
+  // The Results to be emitted, in order, each preceded by its prerequisites,
+  // and whether each one's variable is mentioned by a later one.
+  std::vector<Result *> Nodes;
+  std::vector<bool> NodeUsed;
+  DenseMap<const Result *, unsigned> NodeIndex;
+
+  // The type and value of each parameter slot, in the order they appear.
+  std::vector<std::string> ParamTypes;
+  std::vector<std::string> ParamValues;
+
+  void addParam(StringRef Type, std::string Value) {
+    Layout.AddString(Type);
+    ParamTypes.push_back(std::string(Type));
+    ParamValues.push_back(std::move(Value));
+  }
+
+  // Record a use of the variable holding an earlier Result, either directly
+  // or (if AsValue) via Result::asValue().
+  void addOperand(Result &R, bool AsValue);
+};
+
+// Hands out parameter variable names during code generation. Its allocParam
+// method is invoked by every method of a Result subclass (see below) that has
+// a parameter slot in its shape, in the same order as the slots were recorded.
+// It returns a variable name for the parameter, or (if the slot has the same
+// value for the whole group) it just returns the input expression unchanged.
 
 struct CodeGenParamAllocator {
   // Accumulated during code generation
   std::vector<std::string> *ParamTypes = nullptr;
-  std::vector<std::string> *ParamValues = nullptr;
 
-  // Provided ahead of time in pass 2, to indicate which parameters are being
-  // assigned to what. This vector contains an entry for each call to
-  // allocParam expected during code gen (which we counted up in pass 1), and
-  // indicates the number of the parameter variable that should be returned, or
-  // -1 if this call shouldn't allocate a parameter variable at all.
-  //
-  // We rely on the recursive code generation working identically in passes 1
-  // and 2, so that the same list of calls to allocParam happen in the same
-  // order. That guarantees that the parameter numbers recorded in pass 1 will
-  // match the entries in this vector that store what EmitterBase::EmitBuiltinCG
-  // decided to do about each one in pass 2.
-  std::vector<int> *ParamNumberMap = nullptr;
-
-  // Internally track how many things we've allocated
+  // Provided ahead of time. This vector contains an entry for each parameter
+  // slot in the shape being generated, and indicates the number of the
+  // parameter variable that should be returned, or -1 if this slot shouldn't
+  // allocate a parameter variable at all.
+  const std::vector<int> *ParamNumberMap = nullptr;
+
+  // The slot types from the shape, to check that code generation and the
+  // shape agree on which slot is which.
+  const std::vector<std::string> *SlotTypes = nullptr;
+
+  // Internally track how many slots we've consumed
   unsigned nparams = 0;
 
   std::string allocParam(StringRef Type, StringRef Value) {
-    unsigned ParamNumber;
-
-    if (!ParamNumberMap) {
-      // In pass 1, unconditionally assign a new parameter variable to every
-      // value we're asked to process.
-      ParamNumber = nparams++;
-    } else {
-      // In pass 2, consult the map provided by the caller to find out which
-      // variable we should be keeping things in.
-      int MapValue = (*ParamNumberMap)[nparams++];
-      if (MapValue < 0)
-        return std::string(Value);
-      ParamNumber = MapValue;
-    }
+    assert(nparams < ParamNumberMap->size() &&
+           "code generation used more parameter slots than its shape");
+    assert((*SlotTypes)[nparams] == Type &&
+           "code generation and shape disagree on a parameter slot");
+    int MapValue = (*ParamNumberMap)[nparams++];
+    if (MapValue < 0)
+      return std::string(Value);
+    unsigned ParamNumber = MapValue;
 
     // If we've allocated a new parameter variable for the first time, store
-    // its type and value to be retrieved after codegen.
+    // its type to be retrieved after codegen.
     if (ParamTypes && ParamTypes->size() == ParamNumber)
       ParamTypes->push_back(std::string(Type));
-    if (ParamValues && ParamValues->size() == ParamNumber)
-      ParamValues->push_back(std::string(Value));
 
     // Unimaginative naming scheme for parameter variables.
     return "Param" + utostr(ParamNumber);
@@ -463,16 +491,32 @@ public:
   // Convenient shorthand for the pointer type we'll be using everywhere.
   using Ptr = std::shared_ptr<Result>;
 
+  enum class ResultKind {
+    BuiltinArg,
+    IntLiteral,
+    IntCast,
+    PointerCast,
+    IRBuilder,
+    Address,
+    IRIntrinsic,
+    Type,
+  };
+
 private:
+  const ResultKind RKind;
   Ptr Predecessor;
   std::string VarName;
-  bool VarNameUsed = false;
-  unsigned Visited = 0;
+  std::vector<Result *> DfsOrder;
+
+protected:
+  Result(ResultKind K) : RKind(K) {}
 
 public:
+  ResultKind resultKind() const { return RKind; }
   virtual ~Result() = default;
   using Scope = std::map<std::string, Ptr>;
   virtual void genCode(raw_ostream &OS, CodeGenParamAllocator &) const = 0;
+  virtual void genShape(CodeGenShape &Shape) const = 0;
   virtual bool hasIntegerConstantValue() const { return false; }
   virtual uint32_t integerConstantValue() const { return 0; }
   virtual bool hasIntegerValue() const { return false; }
@@ -481,6 +525,14 @@ public:
   }
   virtual std::string typeName() const { return "Value *"; }
 
+  // Results are hash-consed by EmitterBase, so that the many intrinsics in a
+  // parametrised family (and others that happen to look alike) share the
+  // Results they have in common instead of each building their own. Each
+  // subclass adds everything that distinguishes it from other Results of the
+  // same kind to the profile, referring to other Results and to Types by
+  // pointer, since those are unique already.
+  virtual void profile(FoldingSetNodeID &ID) const = 0;
+
   // Mostly, when a code-generation operation has a dependency on prior
   // operations, it's because it uses the output values of those operations as
   // inputs. But there's one exception, which is the use of 'seq' in Tablegen
@@ -490,10 +542,10 @@ public:
   // So, the actual generation of code is done by depth-first search, using the
   // prerequisites() method to get a list of all the other Results that have to
   // be computed before this one. That method divides into the 'predecessor',
-  // set by setPredecessor() while processing a 'seq' dag node, and the list
-  // returned by 'morePrerequisites', which each subclass implements to return
-  // a list of the Results it uses as input to whatever its own computation is
-  // doing.
+  // given to EmitterBase::getResult while processing a 'seq' dag node, and the
+  // list returned by 'morePrerequisites', which each subclass implements to
+  // return a list of the Results it uses as input to whatever its own
+  // computation is doing.
 
   virtual void morePrerequisites(std::vector<Ptr> &output) const {}
   std::vector<Ptr> prerequisites() const {
@@ -504,50 +556,52 @@ public:
     return ToRet;
   }
 
+  const Ptr &predecessor() const { return Predecessor; }
   void setPredecessor(Ptr p) {
-    // If the user has nested one 'seq' node inside another, and this
-    // method is called on the return value of the inner 'seq' (i.e.
-    // the final item inside it), then we can't link _this_ node to p,
-    // because it already has a predecessor. Instead, walk the chain
-    // until we find the first item in the inner seq, and link that to
-    // p, so that nesting seqs has the obvious effect of linking
-    // everything together into one long sequential chain.
-    Result *r = this;
-    while (r->Predecessor)
-      r = r->Predecessor.get();
-    r->Predecessor = p;
-  }
-
-  // Each Result will be assigned a variable name in the output code, but not
-  // all those variable names will actually be used (e.g. the return value of
-  // Builder.CreateStore has void type, so nobody will want to refer to it). To
-  // prevent annoying compiler warnings, we track whether each Result's
-  // variable name was ever actually mentioned in subsequent statements, so
-  // that it can be left out of the final generated code.
-  std::string varname() {
-    VarNameUsed = true;
-    return VarName;
+    assert(!Predecessor && "Result already has a predecessor");
+    Predecessor = p;
+  }
+
+  // Return the Results that have to be generated to compute this one, in
+  // depth-first order, finishing with this one itself. A Result's
+  // prerequisites never change once it's been built, so the order is worked
+  // out once and cached, and a shared Result reuses the orders already cached
+  // on its own prerequisites.
+  const std::vector<Result *> &dfsOrder() {
+    if (DfsOrder.empty()) {
+      SmallPtrSet<Result *, 16> Seen;
+      for (const Ptr &W : prerequisites())
+        for (Result *X : W->dfsOrder())
+          if (Seen.insert(X).second)
+            DfsOrder.push_back(X);
+      DfsOrder.push_back(this);
+    }
+    return DfsOrder;
   }
+
+  // Each Result will be assigned a variable name in the output code, if any
+  // subsequent statement mentions it. Since a Result can be shared between
+  // intrinsics, the name is set afresh each time an intrinsic's code is
+  // generated.
+  std::string varname() { return VarName; }
   void setVarname(const StringRef s) { VarName = std::string(s); }
-  bool varnameUsed() const { return VarNameUsed; }
 
   // Emit code to generate this result as a Value *.
   virtual std::string asValue() {
     return varname();
   }
-
-  // Code generation happens in multiple passes. This method tracks whether a
-  // Result has yet been visited in a given pass, without the need for a
-  // tedious loop in between passes that goes through and resets a 'visited'
-  // flag back to false: you just set Pass=1 the first time round, and Pass=2
-  // the second time.
-  bool needsVisiting(unsigned Pass) {
-    bool ToRet = Visited < Pass;
-    Visited = Pass;
-    return ToRet;
-  }
+  // True if asValue() wraps the variable name in further code.
+  virtual bool asValueIsWrapped() const { return false; }
 };
 
+void CodeGenShape::addOperand(Result &R, bool AsValue) {
+  auto It = NodeIndex.find(&R);
+  assert(It != NodeIndex.end() && "operand not emitted before its use");
+  Layout.AddBoolean(AsValue && R.asValueIsWrapped());
+  Wiring.AddInteger(It->second);
+  NodeUsed[It->second] = true;
+}
+
 // Result subclass that retrieves one of the arguments to the clang builtin
 // function. In cases where the argument has pointer type, we call
 // EmitPointerWithAlignment and store the result in a variable of type Address,
@@ -564,11 +618,21 @@ public:
   bool AddressType;
   bool Immediate;
   BuiltinArgResult(unsigned ArgNum, bool AddressType, bool Immediate)
-      : ArgNum(ArgNum), AddressType(AddressType), Immediate(Immediate) {}
+      : Result(ResultKind::BuiltinArg), ArgNum(ArgNum),
+        AddressType(AddressType), Immediate(Immediate) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddInteger(ArgNum);
+    ID.AddBoolean(AddressType);
+    ID.AddBoolean(Immediate);
+  }
   void genCode(raw_ostream &OS, CodeGenParamAllocator &) const override {
     OS << (AddressType ? "EmitPointerWithAlignment" : "EmitScalarExpr")
        << "(E->getArg(" << ArgNum << "))";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.Layout.AddBoolean(AddressType);
+    Shape.Layout.AddInteger(ArgNum);
+  }
   std::string typeName() const override {
     return AddressType ? "Address" : Result::typeName();
   }
@@ -578,6 +642,7 @@ public:
       return "(" + varname() + ".getPointer())";
     return Result::asValue();
   }
+  bool asValueIsWrapped() const override { return AddressType; }
   bool hasIntegerValue() const override { return Immediate; }
   std::string getIntegerValue(const std::string &IntType) override {
     return "GetIntegerConstantValue<" + IntType + ">(E->getArg(" +
@@ -594,7 +659,12 @@ public:
   const ScalarType *IntegerType;
   uint32_t IntegerValue;
   IntLiteralResult(const ScalarType *IntegerType, uint32_t IntegerValue)
-      : IntegerType(IntegerType), IntegerValue(IntegerValue) {}
+      : Result(ResultKind::IntLiteral), IntegerType(IntegerType),
+        IntegerValue(IntegerValue) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddPointer(IntegerType);
+    ID.AddInteger(IntegerValue);
+  }
   void genCode(raw_ostream &OS,
                CodeGenParamAllocator &ParamAlloc) const override {
     OS << "llvm::ConstantInt::get("
@@ -603,6 +673,10 @@ public:
     OS << ParamAlloc.allocParam(IntegerType->cName(), utostr(IntegerValue))
        << ")";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.addParam("llvm::Type *", IntegerType->llvmName());
+    Shape.addParam(IntegerType->cName(), utostr(IntegerValue));
+  }
   bool hasIntegerConstantValue() const override { return true; }
   uint32_t integerConstantValue() const override { return IntegerValue; }
 };
@@ -615,7 +689,11 @@ public:
   const ScalarType *IntegerType;
   Ptr V;
   IntCastResult(const ScalarType *IntegerType, Ptr V)
-      : IntegerType(IntegerType), V(V) {}
+      : Result(ResultKind::IntCast), IntegerType(IntegerType), V(V) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddPointer(IntegerType);
+    ID.AddPointer(V.get());
+  }
   void genCode(raw_ostream &OS,
                CodeGenParamAllocator &ParamAlloc) const override {
     OS << "Builder.CreateIntCast(" << V->varname() << ", "
@@ -626,6 +704,13 @@ public:
                                     : "false")
        << ")";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.addOperand(*V, false);
+    Shape.addParam("llvm::Type *", IntegerType->llvmName());
+    Shape.addParam("bool", IntegerType->kind() == ScalarTypeKind::SignedInt
+                               ? "true"
+                               : "false");
+  }
   void morePrerequisites(std::vector<Ptr> &output) const override {
     output.push_back(V);
   }
@@ -637,12 +722,20 @@ public:
   const PointerType *PtrType;
   Ptr V;
   PointerCastResult(const PointerType *PtrType, Ptr V)
-      : PtrType(PtrType), V(V) {}
+      : Result(ResultKind::PointerCast), PtrType(PtrType), V(V) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddPointer(PtrType);
+    ID.AddPointer(V.get());
+  }
   void genCode(raw_ostream &OS,
                CodeGenParamAllocator &ParamAlloc) const override {
     OS << "Builder.CreatePointerCast(" << V->asValue() << ", "
        << ParamAlloc.allocParam("llvm::Type *", PtrType->llvmName()) << ")";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.addOperand(*V, true);
+    Shape.addParam("llvm::Type *", PtrType->llvmName());
+  }
   void morePrerequisites(std::vector<Ptr> &output) const override {
     output.push_back(V);
   }
@@ -661,8 +754,22 @@ public:
   IRBuilderResult(StringRef CallPrefix, std::vector<Ptr> Args,
                   std::set<unsigned> AddressArgs,
                   std::map<unsigned, std::string> IntegerArgs)
-      : CallPrefix(CallPrefix), Args(Args), AddressArgs(AddressArgs),
-        IntegerArgs(IntegerArgs) {}
+      : Result(ResultKind::IRBuilder), CallPrefix(CallPrefix), Args(Args),
+        AddressArgs(AddressArgs), IntegerArgs(IntegerArgs) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddString(CallPrefix);
+    ID.AddInteger(Args.size());
+    for (const Ptr &Arg : Args)
+      ID.AddPointer(Arg.get());
+    ID.AddInteger(AddressArgs.size());
+    for (unsigned Index : AddressArgs)
+      ID.AddInteger(Index);
+    ID.AddInteger(IntegerArgs.size());
+    for (const auto &kv : IntegerArgs) {
+      ID.AddInteger(kv.first);
+      ID.AddString(kv.second);
+    }
+  }
   void genCode(raw_ostream &OS,
                CodeGenParamAllocator &ParamAlloc) const override {
     OS << CallPrefix;
@@ -689,6 +796,29 @@ public:
     }
     OS << ")";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.Layout.AddString(CallPrefix);
+    Shape.Layout.AddInteger(Args.size());
+    for (unsigned i = 0, e = Args.size(); i < e; ++i) {
+      Ptr Arg = Args[i];
+      auto it = IntegerArgs.find(i);
+
+      if (it != IntegerArgs.end()) {
+        if (Arg->hasIntegerConstantValue()) {
+          Shape.Layout.AddInteger(1);
+          Shape.addParam(it->second, utostr(Arg->integerConstantValue()));
+        } else if (Arg->hasIntegerValue()) {
+          Shape.Layout.AddInteger(2);
+          Shape.addParam(it->second, Arg->getIntegerValue(it->second));
+        } else {
+          Shape.Layout.AddInteger(3);
+        }
+      } else {
+        Shape.Layout.AddInteger(0);
+        Shape.addOperand(*Arg, false);
+      }
+    }
+  }
   void morePrerequisites(std::vector<Ptr> &output) const override {
     for (unsigned i = 0, e = Args.size(); i < e; ++i) {
       Ptr Arg = Args[i];
@@ -706,12 +836,22 @@ public:
   const Type *Ty;
   unsigned Align;
   AddressResult(Ptr Arg, const Type *Ty, unsigned Align)
-      : Arg(Arg), Ty(Ty), Align(Align) {}
+      : Result(ResultKind::Address), Arg(Arg), Ty(Ty), Align(Align) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddPointer(Arg.get());
+    ID.AddPointer(Ty);
+    ID.AddInteger(Align);
+  }
   void genCode(raw_ostream &OS,
                CodeGenParamAllocator &ParamAlloc) const override {
     OS << "Address(" << Arg->varname() << ", " << Ty->llvmName()
        << ", CharUnits::fromQuantity(" << Align << "))";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.addOperand(*Arg, false);
+    Shape.Layout.AddString(Ty->llvmName());
+    Shape.Layout.AddInteger(Align);
+  }
   std::string typeName() const override {
     return "Address";
   }
@@ -729,8 +869,17 @@ public:
   std::vector<Ptr> Args;
   IRIntrinsicResult(StringRef IntrinsicID, std::vector<const Type *> ParamTypes,
                     std::vector<Ptr> Args)
-      : IntrinsicID(std::string(IntrinsicID)), ParamTypes(ParamTypes),
-        Args(Args) {}
+      : Result(ResultKind::IRIntrinsic), IntrinsicID(std::string(IntrinsicID)),
+        ParamTypes(ParamTypes), Args(Args) {}
+  void profile(FoldingSetNodeID &ID) const override {
+    ID.AddString(IntrinsicID);
+    ID.AddInteger(ParamTypes.size());
+    for (const Type *T : ParamTypes)
+      ID.AddPointer(T);
+    ID.AddInteger(Args.size());
+    for (const Ptr &Arg : Args)
+      ID.AddPointer(Arg.get());
+  }
   void genCode(raw_ostream &OS,
                CodeGenParamAllocator &ParamAlloc) const override {
     std::string IntNo = ParamAlloc.allocParam(
@@ -753,6 +902,15 @@ public:
     }
     OS << "})";
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.addParam("Intrinsic::ID", "Intrinsic::" + IntrinsicID);
+    Shape.Layout.AddInteger(ParamTypes.size());
+    for (auto T : ParamTypes)
+      Shape.addParam("llvm::Type *", T->llvmName());
+    Shape.Layout.AddInteger(Args.size());
+    for (auto Arg : Args)
+      Shape.addOperand(*Arg, true);
+  }
   void morePrerequisites(std::vector<Ptr> &output) const override {
     output.insert(output.end(), Args.begin(), Args.end());
   }
@@ -763,10 +921,14 @@ public:
 class TypeResult : public Result {
 public:
   const Type *T;
-  TypeResult(const Type *T) : T(T) {}
+  TypeResult(const Type *T) : Result(ResultKind::Type), T(T) {}
+  void profile(FoldingSetNodeID &ID) const override { ID.AddPointer(T); }
   void genCode(raw_ostream &OS, CodeGenParamAllocator &) const override {
     OS << T->llvmName();
   }
+  void genShape(CodeGenShape &Shape) const override {
+    Shape.Layout.AddString(T->llvmName());
+  }
   std::string typeName() const override {
     return "llvm::Type *";
   }
@@ -821,18 +983,6 @@ class ACLEIntrinsic {
 
   std::map<std::string, std::string> CustomCodeGenArgs;
 
-  // Recursive function that does the internals of code generation.
-  void genCodeDfs(Result::Ptr V, std::list<Result::Ptr> &Used,
-                  unsigned Pass) const {
-    if (!V->needsVisiting(Pass))
-      return;
-
-    for (Result::Ptr W : V->prerequisites())
-      genCodeDfs(W, Used, Pass);
-
-    Used.push_back(V);
-  }
-
 public:
   const std::string &shortName() const { return ShortName; }
   const std::string &fullName() const { return FullName; }
@@ -856,9 +1006,31 @@ public:
   bool nonEvaluating() const { return NonEvaluating; }
   bool headerOnly() const { return HeaderOnly; }
 
-  // External entry point for code generation, called from EmitterBase.
+  // Describe the shape of this intrinsic's code generation, for EmitterBase
+  // to group it with others that can share the same code.
+  void genShape(CodeGenShape &Shape) const {
+    assert(!headerOnly() && "Called genShape for header-only intrinsic");
+    if (!hasCode()) {
+      Shape.Layout.AddString("CustomCodegen");
+      for (const auto &kv : CustomCodeGenArgs) {
+        Shape.Layout.AddString(kv.first);
+        Shape.Layout.AddString(kv.second);
+      }
+      return;
+    }
+    for (Result *V : Code->dfsOrder()) {
+      Shape.NodeIndex[V] = Shape.Nodes.size();
+      Shape.Nodes.push_back(V);
+      Shape.NodeUsed.push_back(false);
+      Shape.Layout.AddInteger(unsigned(V->resultKind()));
+      V->genShape(Shape);
+    }
+  }
+
+  // External entry point for code generation, called from EmitterBase with
+  // the shape previously filled in by genShape.
   void genCode(raw_ostream &OS, CodeGenParamAllocator &ParamAlloc,
-               unsigned Pass) const {
+               const CodeGenShape &Shape) const {
     assert(!headerOnly() && "Called genCode for header-only intrinsic");
     if (!hasCode()) {
       for (auto kv : CustomCodeGenArgs)
@@ -866,20 +1038,19 @@ public:
       OS << "  break; // custom code gen\n";
       return;
     }
-    std::list<Result::Ptr> Used;
-    genCodeDfs(Code, Used, Pass);
+    const std::vector<Result *> &Used = Shape.Nodes;
 
     unsigned varindex = 0;
-    for (Result::Ptr V : Used)
-      if (V->varnameUsed())
-        V->setVarname("Val" + utostr(varindex++));
+    for (size_t i = 0, e = Used.size(); i < e; ++i)
+      Used[i]->setVarname(Shape.NodeUsed[i] ? "Val" + utostr(varindex++) : "");
 
-    for (Result::Ptr V : Used) {
+    for (size_t i = 0, e = Used.size(); i < e; ++i) {
+      Result *V = Used[i];
       OS << "  ";
-      if (V == Used.back()) {
-        assert(!V->varnameUsed());
+      if (i + 1 == e) {
+        assert(!Shape.NodeUsed[i]);
         OS << "return "; // FIXME: what if the top-level thing is void?
-      } else if (V->varnameUsed()) {
+      } else if (Shape.NodeUsed[i]) {
         std::string Type = V->typeName();
         OS << V->typeName();
         if (!StringRef(Type).endswith("*"))
@@ -889,6 +1060,8 @@ public:
       V->genCode(OS, ParamAlloc);
       OS << ";\n";
     }
+    assert(ParamAlloc.nparams == Shape.ParamTypes.size() &&
+           "code generation used fewer parameter slots than its shape");
   }
   bool hasCode() const { return Code != nullptr; }
 
@@ -899,9 +1072,17 @@ public:
     return std::string(s.str());
   }
 
-  std::string genSema() const {
+  // A check that Sema makes on an immediate argument, by calling
+  // SemaBuiltinConstantArg<Kind> with the argument index followed by Args.
+  struct SemaCheck {
+    unsigned ArgIndex;
+    std::string Kind;
+    SmallVector<std::string, 2> Args;
+  };
+
+  std::vector<SemaCheck> genSemaChecks() const {
     assert(!headerOnly() && "Called genSema for header-only intrinsic");
-    std::vector<std::string> SemaChecks;
+    std::vector<SemaCheck> SemaChecks;
 
     for (const auto &kv : ImmediateArgs) {
       const ImmediateArg &IA = kv.second;
@@ -918,8 +1099,6 @@ public:
         break;
       }
 
-      std::string Index = utostr(kv.first);
-
       // Emit a range check if the legal range of values for the
       // immediate is smaller than the _possible_ range of values for
       // its type.
@@ -927,29 +1106,35 @@ public:
       llvm::APInt ArgTypeRange = llvm::APInt::getMaxValue(ArgTypeBits).zext(128);
       llvm::APInt ActualRange = (hi-lo).trunc(64).sext(128);
       if (ActualRange.ult(ArgTypeRange))
-        SemaChecks.push_back("SemaBuiltinConstantArgRange(TheCall, " + Index +
-                             ", " + signedHexLiteral(lo) + ", " +
-                             signedHexLiteral(hi) + ")");
+        SemaChecks.push_back(
+            {kv.first, "Range", {signedHexLiteral(lo), signedHexLiteral(hi)}});
 
       if (!IA.ExtraCheckType.empty()) {
-        std::string Suffix;
+        SemaCheck Check{kv.first, std::string(IA.ExtraCheckType), {}};
         if (!IA.ExtraCheckArgs.empty()) {
-          std::string tmp;
           StringRef Arg = IA.ExtraCheckArgs;
-          if (Arg == "!lanesize") {
-            tmp = utostr(IA.ArgType->sizeInBits());
-            Arg = tmp;
-          }
-          Suffix = (Twine(", ") + Arg).str();
+          if (Arg == "!lanesize")
+            Check.Args.push_back(utostr(IA.ArgType->sizeInBits()));
+          else
+            Check.Args.push_back(std::string(Arg));
         }
-        SemaChecks.push_back((Twine("SemaBuiltinConstantArg") +
-                              IA.ExtraCheckType + "(TheCall, " + Index +
-                              Suffix + ")")
-                                 .str());
+        SemaChecks.push_back(std::move(Check));
       }
 
       assert(!SemaChecks.empty());
     }
+    return SemaChecks;
+  }
+
+  std::string genSema() const {
+    std::vector<std::string> SemaChecks;
+    for (const SemaCheck &Check : genSemaChecks()) {
+      std::string Call = "SemaBuiltinConstantArg" + Check.Kind + "(TheCall, " +
+                         utostr(Check.ArgIndex);
+      for (const std::string &Arg : Check.Args)
+        Call += ", " + Arg;
+      SemaChecks.push_back(Call + ")");
+    }
     if (SemaChecks.empty())
       return "";
     return join(std::begin(SemaChecks), std::end(SemaChecks),
@@ -966,59 +1151,94 @@ public:
 
 class EmitterBase {
 protected:
-  // EmitterBase holds a collection of all the types we've instantiated.
-  VoidType Void;
-  std::map<std::string, std::unique_ptr<ScalarType>> ScalarTypes;
-  std::map<std::tuple<ScalarTypeKind, unsigned, unsigned>,
-           std::unique_ptr<VectorType>>
-      VectorTypes;
-  std::map<std::pair<std::string, unsigned>, std::unique_ptr<MultiVectorType>>
-      MultiVectorTypes;
-  std::map<unsigned, std::unique_ptr<PredicateType>> PredicateTypes;
-  std::map<std::string, std::unique_ptr<PointerType>> PointerTypes;
+  // EmitterBase holds all the types we've instantiated in a single arena,
+  // where each one is identified by a dense integer handle (its index). Types
+  // made out of other types are found through a single map, keyed by the
+  // kind of type being made and the handles and numbers it's made from.
+  std::vector<std::unique_ptr<Type>> Types;
+  using TypeKey = std::tuple<unsigned, unsigned, unsigned>;
+  DenseMap<TypeKey, unsigned> TypeHandles;
+  static TypeKey typeKey(Type::TypeKind K, unsigned A, unsigned B) {
+    return TypeKey(unsigned(K), A, B);
+  }
+
+  const VoidType *Void;
+
+  // The ScalarTypes, in name order, and indexed by name. Scalar types are
+  // also in TypeHandles under (Scalar, kind, size), which finds the first one
+  // in name order with that kind and size.
+  std::vector<const ScalarType *> ScalarTypes;
+  StringMap<const ScalarType *> ScalarTypesByName;
 
   // And all the ACLEIntrinsic instances we've created.
   std::map<std::string, std::unique_ptr<ACLEIntrinsic>> ACLEIntrinsics;
 
+  // Every Result built for any intrinsic, keyed by its profile.
+  std::map<FoldingSetNodeID, Result::Ptr> Results;
+
+  // How many times each Result has been asked for while building the current
+  // intrinsic.
+  DenseMap<const Result *, unsigned> ResultUses;
+
+  // Add a new type to the arena.
+  template <typename T, typename... Ts> T *addType(Ts &&... Args) {
+    auto NewType = std::make_unique<T>(std::forward<Ts>(Args)...);
+    T *Ptr = NewType.get();
+    Ptr->Handle = Types.size();
+    Types.push_back(std::move(NewType));
+    return Ptr;
+  }
+
+  // Return the type stored under (K, A, B), constructing it from Args if
+  // there isn't one yet.
+  template <typename T, typename... Ts>
+  const T *getDerivedType(Type::TypeKind K, unsigned A, unsigned B,
+                          Ts &&... Args) {
+    auto Ins = TypeHandles.try_emplace(typeKey(K, A, B), Types.size());
+    if (Ins.second)
+      addType<T>(std::forward<Ts>(Args)...);
+    return cast<T>(Types[Ins.first->second].get());
+  }
+
 public:
   // Methods to create a Type object, or return the right existing one from the
-  // maps stored in this object.
-  const VoidType *getVoidType() { return &Void; }
+  // arena stored in this object.
+  const VoidType *getVoidType() { return Void; }
   const ScalarType *getScalarType(StringRef Name) {
-    return ScalarTypes[std::string(Name)].get();
+    return ScalarTypesByName.lookup(Name);
   }
   const ScalarType *getScalarType(Record *R) {
     return getScalarType(R->getName());
   }
+  const ScalarType *getScalarType(ScalarTypeKind Kind, unsigned Bits) {
+    auto It =
+        TypeHandles.find(typeKey(Type::TypeKind::Scalar, unsigned(Kind), Bits));
+    if (It == TypeHandles.end())
+      return nullptr;
+    return cast<ScalarType>(Types[It->second].get());
+  }
   const VectorType *getVectorType(const ScalarType *ST, unsigned Lanes) {
-    std::tuple<ScalarTypeKind, unsigned, unsigned> key(ST->kind(),
-                                                       ST->sizeInBits(), Lanes);
-    if (VectorTypes.find(key) == VectorTypes.end())
-      VectorTypes[key] = std::make_unique<VectorType>(ST, Lanes);
-    return VectorTypes[key].get();
+    // Scalar types with the same kind and size make the same vector type, so
+    // the key uses the first such scalar type as the element.
+    const ScalarType *Element = getScalarType(ST->kind(), ST->sizeInBits());
+    return getDerivedType<VectorType>(Type::TypeKind::Vector,
+                                      Element->handle(), Lanes, Element, Lanes);
   }
   const VectorType *getVectorType(const ScalarType *ST) {
     return getVectorType(ST, 128 / ST->sizeInBits());
   }
   const MultiVectorType *getMultiVectorType(unsigned Registers,
                                             const VectorType *VT) {
-    std::pair<std::string, unsigned> key(VT->cNameBase(), Registers);
-    if (MultiVectorTypes.find(key) == MultiVectorTypes.end())
-      MultiVectorTypes[key] = std::make_unique<MultiVectorType>(Registers, VT);
-    return MultiVectorTypes[key].get();
+    return getDerivedType<MultiVectorType>(
+        Type::TypeKind::MultiVector, VT->handle(), Registers, Registers, VT);
   }
   const PredicateType *getPredicateType(unsigned Lanes) {
-    unsigned key = Lanes;
-    if (PredicateTypes.find(key) == PredicateTypes.end())
-      PredicateTypes[key] = std::make_unique<PredicateType>(Lanes);
-    return PredicateTypes[key].get();
+    return getDerivedType<PredicateType>(Type::TypeKind::Predicate, Lanes, 0,
+                                         Lanes);
   }
   const PointerType *getPointerType(const Type *T, bool Const) {
-    PointerType PT(T, Const);
-    std::string key = PT.cName();
-    if (PointerTypes.find(key) == PointerTypes.end())
-      PointerTypes[key] = std::make_unique<PointerType>(PT);
-    return PointerTypes[key].get();
+    return getDerivedType<PointerType>(Type::TypeKind::Pointer, T->handle(),
+                                       Const, T, Const);
   }
 
   // Methods to construct a type from various pieces of Tablegen. These are
@@ -1031,17 +1251,54 @@ public:
   const Type *getType(DagInit *D, const Type *Param);
   const Type *getType(Init *I, const Type *Param);
 
+  // Return the Result made by constructing a T from Args, with the given
+  // predecessor, or an existing one identical to it.
+  //
+  // Two identical operations within a single intrinsic still get separate
+  // Results, because the Tablegen asked for the operation to be done twice
+  // (e.g. two loads from the same address, either side of a store). So the
+  // n-th request for a given Result while building one intrinsic returns the
+  // n-th copy of it, which is shared with every other intrinsic that asks for
+  // the same thing n times.
+  template <typename T, typename... Ts>
+  Result::Ptr getResult(Result::Ptr Predecessor, Ts &&... Args) {
+    T Candidate(std::forward<Ts>(Args)...);
+    Candidate.setPredecessor(Predecessor);
+
+    FoldingSetNodeID ID;
+    ID.AddInteger(unsigned(Candidate.resultKind()));
+    ID.AddPointer(Predecessor.get());
+    Candidate.profile(ID);
+
+    Result::Ptr &First = Results[ID];
+    if (!First)
+      First = std::make_shared<T>(Candidate);
+    unsigned Occurrence = ResultUses[First.get()]++;
+    if (Occurrence == 0)
+      return First;
+
+    ID.AddInteger(Occurrence);
+    Result::Ptr &Repeat = Results[ID];
+    if (!Repeat)
+      Repeat = std::make_shared<T>(Candidate);
+    return Repeat;
+  }
+
   // Functions that translate the Tablegen representation of an intrinsic's
   // code generation into a collection of Value objects (which will then be
   // reprocessed to read out the actual C++ code included by CGBuiltin.cpp).
+  // The Result returned by getCodeForDag is sequenced after Predecessor, if
+  // one is given.
   Result::Ptr getCodeForDag(DagInit *D, const Result::Scope &Scope,
-                            const Type *Param);
+                            const Type *Param,
+                            Result::Ptr Predecessor = nullptr);
   Result::Ptr getCodeForDagArg(DagInit *D, unsigned ArgNum,
                                const Result::Scope &Scope, const Type *Param);
   Result::Ptr getCodeForArg(unsigned ArgNum, const Type *ArgType, bool Promote,
                             bool Immediate);
 
   void GroupSemaChecks(std::map<std::string, std::set<std::string>> &Checks);
+  void EmitSemaCheckTable(raw_ostream &OS, StringRef BuiltinPrefix);
 
   // Constructor and top-level functions.
 
@@ -1128,11 +1385,9 @@ const Type *EmitterBase::getType(DagInit *D, const Type *Param) {
   if (Op->getName() == "CTO_CopyKind") {
     const ScalarType *STSize = cast<ScalarType>(getType(D->getArg(0), Param));
     const ScalarType *STKind = cast<ScalarType>(getType(D->getArg(1), Param));
-    for (const auto &kv : ScalarTypes) {
-      const ScalarType *RT = kv.second.get();
-      if (RT->kind() == STKind->kind() && RT->sizeInBits() == STSize->sizeInBits())
-        return RT;
-    }
+    if (const ScalarType *RT =
+            getScalarType(STKind->kind(), STSize->sizeInBits()))
+      return RT;
     PrintFatalError("Cannot find a type to satisfy CopyKind");
   }
 
@@ -1140,11 +1395,8 @@ const Type *EmitterBase::getType(DagInit *D, const Type *Param) {
     const ScalarType *STKind = cast<ScalarType>(getType(D->getArg(0), Param));
     int Num = Op->getValueAsInt("num"), Denom = Op->getValueAsInt("denom");
     unsigned DesiredSize = STKind->sizeInBits() * Num / Denom;
-    for (const auto &kv : ScalarTypes) {
-      const ScalarType *RT = kv.second.get();
-      if (RT->kind() == STKind->kind() && RT->sizeInBits() == DesiredSize)
-        return RT;
-    }
+    if (const ScalarType *RT = getScalarType(STKind->kind(), DesiredSize))
+      return RT;
     PrintFatalError("Cannot find a type to satisfy ScaleSize");
   }
 
@@ -1152,22 +1404,26 @@ const Type *EmitterBase::getType(DagInit *D, const Type *Param) {
 }
 
 Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
-                                       const Type *Param) {
+                                       const Type *Param,
+                                       Result::Ptr Predecessor) {
   Record *Op = cast<DefInit>(D->getOperator())->getDef();
 
   if (Op->getName() == "seq") {
+    // Each item in the seq is built with the previous one as its
+    // predecessor. If the user has nested one 'seq' node inside another, the
+    // first item of the inner one is linked to whatever came before the
+    // inner seq, so that nesting seqs has the obvious effect of linking
+    // everything together into one long sequential chain.
     Result::Scope SubScope = Scope;
-    Result::Ptr PrevV = nullptr;
+    Result::Ptr PrevV = Predecessor;
     for (unsigned i = 0, e = D->getNumArgs(); i < e; ++i) {
       // We don't use getCodeForDagArg here, because the argument name
       // has different semantics in a seq
       Result::Ptr V =
-          getCodeForDag(cast<DagInit>(D->getArg(i)), SubScope, Param);
+          getCodeForDag(cast<DagInit>(D->getArg(i)), SubScope, Param, PrevV);
       StringRef ArgName = D->getArgNameStr(i);
       if (!ArgName.empty())
         SubScope[std::string(ArgName)] = V;
-      if (PrevV)
-        V->setPredecessor(PrevV);
       PrevV = V;
     }
     return PrevV;
@@ -1179,13 +1435,13 @@ Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
     if (const auto *ST = dyn_cast<ScalarType>(CastType)) {
       if (!ST->requiresFloat()) {
         if (Arg->hasIntegerConstantValue())
-          return std::make_shared<IntLiteralResult>(
-              ST, Arg->integerConstantValue());
+          return getResult<IntLiteralResult>(Predecessor, ST,
+                                             Arg->integerConstantValue());
         else
-          return std::make_shared<IntCastResult>(ST, Arg);
+          return getResult<IntCastResult>(Predecessor, ST, Arg);
       }
     } else if (const auto *PT = dyn_cast<PointerType>(CastType)) {
-      return std::make_shared<PointerCastResult>(PT, Arg);
+      return getResult<PointerCastResult>(Predecessor, PT, Arg);
     }
     PrintFatalError("Unsupported type cast");
   } else if (Op->getName() == "address") {
@@ -1206,7 +1462,7 @@ Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
     } else {
       PrintFatalError("'address' alignment argument should be an integer");
     }
-    return std::make_shared<AddressResult>(Arg, Ty, Alignment);
+    return getResult<AddressResult>(Predecessor, Arg, Ty, Alignment);
   } else if (Op->getName() == "unsignedflag") {
     if (D->getNumArgs() != 1)
       PrintFatalError("unsignedflag should have exactly one argument");
@@ -1214,8 +1470,9 @@ Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
     if (!TypeRec->isSubClassOf("Type"))
       PrintFatalError("unsignedflag's argument should be a type");
     if (const auto *ST = dyn_cast<ScalarType>(getType(TypeRec, Param))) {
-      return std::make_shared<IntLiteralResult>(
-        getScalarType("u32"), ST->kind() == ScalarTypeKind::UnsignedInt);
+      return getResult<IntLiteralResult>(
+          Predecessor, getScalarType("u32"),
+          ST->kind() == ScalarTypeKind::UnsignedInt);
     } else {
       PrintFatalError("unsignedflag's argument should be a scalar type");
     }
@@ -1226,8 +1483,8 @@ Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
     if (!TypeRec->isSubClassOf("Type"))
       PrintFatalError("bitsize's argument should be a type");
     if (const auto *ST = dyn_cast<ScalarType>(getType(TypeRec, Param))) {
-      return std::make_shared<IntLiteralResult>(getScalarType("u32"),
-                                                ST->sizeInBits());
+      return getResult<IntLiteralResult>(Predecessor, getScalarType("u32"),
+                                         ST->sizeInBits());
     } else {
       PrintFatalError("bitsize's argument should be a scalar type");
     }
@@ -1246,8 +1503,9 @@ Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
           IntegerArgs[Index] = std::string(sp->getValueAsString("type"));
         }
       }
-      return std::make_shared<IRBuilderResult>(Op->getValueAsString("prefix"),
-                                               Args, AddressArgs, IntegerArgs);
+      return getResult<IRBuilderResult>(Predecessor,
+                                        Op->getValueAsString("prefix"), Args,
+                                        AddressArgs, IntegerArgs);
     } else if (Op->isSubClassOf("IRIntBase")) {
       std::vector<const Type *> ParamTypes;
       for (Record *RParam : Op->getValueAsListOfDefs("params"))
@@ -1255,7 +1513,8 @@ Result::Ptr EmitterBase::getCodeForDag(DagInit *D, const Result::Scope &Scope,
       std::string IntName = std::string(Op->getValueAsString("intname"));
       if (Op->getValueAsBit("appendKind"))
         IntName += "_" + toLetter(cast<ScalarType>(Param)->kind());
-      return std::make_shared<IRIntrinsicResult>(IntName, ParamTypes, Args);
+      return getResult<IRIntrinsicResult>(Predecessor, IntName, ParamTypes,
+                                          Args);
     } else {
       PrintFatalError("Unsupported dag node " + Op->getName());
     }
@@ -1282,12 +1541,12 @@ Result::Ptr EmitterBase::getCodeForDagArg(DagInit *D, unsigned ArgNum,
   // checking, integers would sneak through the bit declaration,
   // but now they really are bits.
   if (auto *BI = dyn_cast<BitInit>(Arg))
-    return std::make_shared<IntLiteralResult>(getScalarType("u32"),
-                                              BI->getValue());
+    return getResult<IntLiteralResult>(nullptr, getScalarType("u32"),
+                                       BI->getValue());
 
   if (auto *II = dyn_cast<IntInit>(Arg))
-    return std::make_shared<IntLiteralResult>(getScalarType("u32"),
-                                              II->getValue());
+    return getResult<IntLiteralResult>(nullptr, getScalarType("u32"),
+                                       II->getValue());
 
   if (auto *DI = dyn_cast<DagInit>(Arg))
     return getCodeForDag(DI, Scope, Param);
@@ -1296,7 +1555,7 @@ Result::Ptr EmitterBase::getCodeForDagArg(DagInit *D, unsigned ArgNum,
     Record *Rec = DI->getDef();
     if (Rec->isSubClassOf("Type")) {
       const Type *T = getType(Rec, Param);
-      return std::make_shared<TypeResult>(T);
+      return getResult<TypeResult>(nullptr, T);
     }
   }
 
@@ -1309,18 +1568,18 @@ Result::Ptr EmitterBase::getCodeForDagArg(DagInit *D, unsigned ArgNum,
 
 Result::Ptr EmitterBase::getCodeForArg(unsigned ArgNum, const Type *ArgType,
                                        bool Promote, bool Immediate) {
-  Result::Ptr V = std::make_shared<BuiltinArgResult>(
-      ArgNum, isa<PointerType>(ArgType), Immediate);
+  Result::Ptr V = getResult<BuiltinArgResult>(
+      nullptr, ArgNum, isa<PointerType>(ArgType), Immediate);
 
   if (Promote) {
     if (const auto *ST = dyn_cast<ScalarType>(ArgType)) {
       if (ST->isInteger() && ST->sizeInBits() < 32)
-        V = std::make_shared<IntCastResult>(getScalarType("u32"), V);
+        V = getResult<IntCastResult>(nullptr, getScalarType("u32"), V);
     } else if (const auto *PT = dyn_cast<PredicateType>(ArgType)) {
-      V = std::make_shared<IntCastResult>(getScalarType("u32"), V);
-      V = std::make_shared<IRIntrinsicResult>("arm_mve_pred_i2v",
-                                              std::vector<const Type *>{PT},
-                                              std::vector<Result::Ptr>{V});
+      V = getResult<IntCastResult>(nullptr, getScalarType("u32"), V);
+      V = getResult<IRIntrinsicResult>(nullptr, "arm_mve_pred_i2v",
+                                       std::vector<const Type *>{PT},
+                                       std::vector<Result::Ptr>{V});
     }
   }
 
@@ -1471,14 +1730,28 @@ EmitterBase::EmitterBase(RecordKeeper &Records) {
   // collect all the useful ScalarType instances into a big list so that we can
   // use it for operations such as 'find the unsigned version of this signed
   // integer type'.
-  for (Record *R : Records.getAllDerivedDefinitions("PrimitiveType"))
-    ScalarTypes[std::string(R->getName())] = std::make_unique<ScalarType>(R);
+  Void = addType<VoidType>();
+
+  std::vector<Record *> PrimitiveTypes =
+      Records.getAllDerivedDefinitions("PrimitiveType");
+  llvm::sort(PrimitiveTypes, [](Record *A, Record *B) {
+    return A->getName() < B->getName();
+  });
+  for (Record *R : PrimitiveTypes) {
+    const ScalarType *ST = addType<ScalarType>(R);
+    ScalarTypes.push_back(ST);
+    ScalarTypesByName[R->getName()] = ST;
+    TypeHandles.try_emplace(typeKey(Type::TypeKind::Scalar,
+                                    unsigned(ST->kind()), ST->sizeInBits()),
+                            ST->handle());
+  }
 
   // Now go through the instances of Intrinsic, and for each one, iterate
   // through its list of type parameters making an ACLEIntrinsic for each one.
   for (Record *R : Records.getAllDerivedDefinitions("Intrinsic")) {
     for (Record *RParam : R->getValueAsListOfDefs("params")) {
       const Type *Param = getType(RParam, getVoidType());
+      ResultUses.clear();
       auto Intrinsic = std::make_unique<ACLEIntrinsic>(*this, R, Param);
       ACLEIntrinsics[Intrinsic->fullName()] = std::move(Intrinsic);
     }
@@ -1561,54 +1834,48 @@ struct MergeableGroup {
 };
 
 void EmitterBase::EmitBuiltinCG(raw_ostream &OS) {
-  // Pass 1: generate code for all the intrinsics as if every type or constant
-  // that can possibly be abstracted out into a parameter variable will be.
-  // This identifies the sets of intrinsics we'll group together into a single
-  // piece of code generation.
+  // Record the shape of every intrinsic's code generation, and group together
+  // the ones whose layouts match. Those are the sets of intrinsics we'll
+  // implement with a single piece of code generation.
 
-  std::map<MergeableGroup, std::set<OutputIntrinsic>> MergeableGroupsPrelim;
+  using ShapedIntrinsic = std::pair<const ACLEIntrinsic *, CodeGenShape>;
+  std::map<FoldingSetNodeID, std::vector<ShapedIntrinsic>> Candidates;
 
   for (const auto &kv : ACLEIntrinsics) {
     const ACLEIntrinsic &Int = *kv.second;
     if (Int.headerOnly())
       continue;
 
-    MergeableGroup MG;
-    OutputIntrinsic OI;
-
-    OI.Int = &Int;
-    OI.Name = Int.fullName();
-    CodeGenParamAllocator ParamAllocPrelim{&MG.ParamTypes, &OI.ParamValues};
-    raw_string_ostream OS(MG.Code);
-    Int.genCode(OS, ParamAllocPrelim, 1);
-    OS.flush();
-
-    MergeableGroupsPrelim[MG].insert(OI);
+    CodeGenShape Shape;
+    Int.genShape(Shape);
+    FoldingSetNodeID Layout = Shape.Layout;
+    Candidates[Layout].emplace_back(&Int, std::move(Shape));
   }
 
-  // Pass 2: for each of those groups, optimize the parameter variable set by
+  // For each of those groups, optimize the parameter variable set by
   // eliminating 'parameters' that are the same for all intrinsics in the
   // group, and merging together pairs of parameter variables that take the
-  // same values as each other for all intrinsics in the group.
+  // same values as each other for all intrinsics in the group. Then generate
+  // the code once for each distinct wiring within the group.
 
   std::map<MergeableGroup, std::set<OutputIntrinsic>> MergeableGroups;
 
-  for (const auto &kv : MergeableGroupsPrelim) {
-    const MergeableGroup &MG = kv.first;
+  for (const auto &kv : Candidates) {
+    const std::vector<ShapedIntrinsic> &Group = kv.second;
+    const CodeGenShape &FirstShape = Group.front().second;
     std::vector<int> ParamNumbers;
     std::map<ComparableStringVector, int> ParamNumberMap;
 
-    // Loop over the parameters for this group.
-    for (size_t i = 0, e = MG.ParamTypes.size(); i < e; ++i) {
+    // Loop over the parameter slots for this group.
+    for (size_t i = 0, e = FirstShape.ParamTypes.size(); i < e; ++i) {
       // Is this parameter the same for all intrinsics in the group?
-      const OutputIntrinsic &OI_first = *kv.second.begin();
-      bool Constant = all_of(kv.second, [&](const OutputIntrinsic &OI) {
-        return OI.ParamValues[i] == OI_first.ParamValues[i];
+      bool Constant = all_of(Group, [&](const ShapedIntrinsic &SI) {
+        return SI.second.ParamValues[i] == FirstShape.ParamValues[i];
       });
 
       // If so, record it as -1, meaning 'no parameter variable needed'. Then
-      // the corresponding call to allocParam in pass 2 will not generate a
-      // variable at all, and just use the value inline.
+      // the corresponding call to allocParam during code generation will not
+      // generate a variable at all, and just use the value inline.
       if (Constant) {
         ParamNumbers.push_back(-1);
         continue;
@@ -1621,9 +1888,9 @@ void EmitterBase::EmitBuiltinCG(raw_ostream &OS) {
       // there's much chance of them having textually equivalent values, but in
       // _principle_ it could happen.)
       ComparableStringVector key;
-      key.push_back(MG.ParamTypes[i]);
-      for (const auto &OI : kv.second)
-        key.push_back(OI.ParamValues[i]);
+      key.push_back(FirstShape.ParamTypes[i]);
+      for (const auto &SI : Group)
+        key.push_back(SI.second.ParamValues[i]);
 
       auto Found = ParamNumberMap.find(key);
       if (Found != ParamNumberMap.end()) {
@@ -1638,22 +1905,33 @@ void EmitterBase::EmitBuiltinCG(raw_ostream &OS) {
       ParamNumbers.push_back(ExistingIndex);
     }
 
-    // Now we're ready to do the pass 2 code generation, which will emit the
-    // reduced set of parameter variables we've just worked out.
+    // Now generate the code, with the reduced set of parameter variables
+    // we've just worked out, once for each wiring of the layout.
 
-    for (const auto &OI_prelim : kv.second) {
-      const ACLEIntrinsic *Int = OI_prelim.Int;
+    std::map<FoldingSetNodeID, MergeableGroup> Generated;
 
-      MergeableGroup MG;
-      OutputIntrinsic OI;
+    for (const auto &SI : Group) {
+      const ACLEIntrinsic *Int = SI.first;
+      const CodeGenShape &Shape = SI.second;
 
-      OI.Int = OI_prelim.Int;
-      OI.Name = OI_prelim.Name;
-      CodeGenParamAllocator ParamAlloc{&MG.ParamTypes, &OI.ParamValues,
-                                       &ParamNumbers};
-      raw_string_ostream OS(MG.Code);
-      Int->genCode(OS, ParamAlloc, 2);
-      OS.flush();
+      auto Ins = Generated.try_emplace(Shape.Wiring);
+      MergeableGroup &MG = Ins.first->second;
+      if (Ins.second) {
+        CodeGenParamAllocator ParamAlloc{&MG.ParamTypes, &ParamNumbers,
+                                         &Shape.ParamTypes};
+        raw_string_ostream OS(MG.Code);
+        Int->genCode(OS, ParamAlloc, Shape);
+        OS.flush();
+      }
+
+      // Each intrinsic's parameter values come straight out of its shape.
+      OutputIntrinsic OI;
+      OI.Int = Int;
+      OI.Name = Int->fullName();
+      OI.ParamValues.resize(ParamNumberMap.size());
+      for (size_t i = 0, e = ParamNumbers.size(); i < e; ++i)
+        if (ParamNumbers[i] >= 0)
+          OI.ParamValues[ParamNumbers[i]] = Shape.ParamValues[i];
 
       MergeableGroups[MG].insert(OI);
     }
@@ -1745,6 +2023,49 @@ void EmitterBase::GroupSemaChecks(
   }
 }
 
+// EmitSemaCheckTable writes one row per immediate check instead of the switch
+// cases of EmitBuiltinSema, leaving the lookup to Sema:
+//
+// \code
+// #ifdef GET_MVE_IMMEDIATE_CHECKS
+// MVE_IMMEDIATE_CHECK(vshlq_n_s8, 1, Range, 0x0, 0x7)
+// MVE_IMMEDIATE_CHECK(vldrwq_gather_base_s32, 1, Multiple, 4, 0)
+// #endif
+// \endcode
+//
+// The columns are the builtin name without __builtin_arm_mve_, the argument
+// index, the Kind of SemaBuiltinConstantArg<Kind> to call, and the arguments
+// passed to it after the index, or 0 if it takes fewer. CDE rows use the
+// CDE_ prefix instead. The rows are in builtin name order, which is the order
+// of EmitBuiltinDef, so they are sorted by builtin ID only as long as
+// BuiltinsARM.def includes the generated builtins without reordering them.
+void EmitterBase::EmitSemaCheckTable(raw_ostream &OS, StringRef BuiltinPrefix) {
+  std::string Prefix = BuiltinPrefix.upper();
+  std::map<std::string, size_t> KindArgs;
+
+  OS << "#ifdef GET_" << Prefix << "_IMMEDIATE_CHECKS\n";
+  OS << "// Sorted by builtin ID, assuming BuiltinsARM.def declares the "
+     << BuiltinPrefix << " builtins\n"
+     << "// in the order of arm_" << BuiltinPrefix << "_builtins.inc.\n";
+  for (const auto &kv : ACLEIntrinsics) {
+    const ACLEIntrinsic &Int = *kv.second;
+    if (Int.headerOnly())
+      continue;
+    for (const ACLEIntrinsic::SemaCheck &Check : Int.genSemaChecks()) {
+      auto Ins = KindArgs.insert({Check.Kind, Check.Args.size()});
+      if (Ins.first->second != Check.Args.size())
+        PrintFatalError("immediate check kind '" + Check.Kind +
+                        "' is used with different numbers of arguments");
+      OS << Prefix << "_IMMEDIATE_CHECK(" << Int.fullName() << ", "
+         << Check.ArgIndex << ", " << Check.Kind;
+      for (unsigned i = 0; i < 2; ++i)
+        OS << ", " << (i < Check.Args.size() ? Check.Args[i] : "0");
+      OS << ")\n";
+    }
+  }
+  OS << "#endif\n";
+}
+
 // -----------------------------------------------------------------------------
 // The class used for generating arm_mve.h and related Clang bits
 //
@@ -1773,8 +2094,7 @@ void MveEmitter::EmitHeader(raw_ostream &OS) {
   parts[0] << "typedef uint16_t mve_pred16_t;\n";
   parts[Float] << "typedef __fp16 float16_t;\n"
                   "typedef float float32_t;\n";
-  for (const auto &kv : ScalarTypes) {
-    const ScalarType *ST = kv.second.get();
+  for (const ScalarType *ST : ScalarTypes) {
     if (ST->hasNonstandardName())
       continue;
     raw_ostream &OS = parts[ST->requiresFloat() ? Float : 0];
@@ -2037,8 +2357,7 @@ void CdeEmitter::EmitHeader(raw_ostream &OS) {
   parts[MVE] << "typedef uint16_t mve_pred16_t;\n";
   parts[MVEFloat] << "typedef __fp16 float16_t;\n"
                      "typedef float float32_t;\n";
-  for (const auto &kv : ScalarTypes) {
-    const ScalarType *ST = kv.second.get();
+  for (const ScalarType *ST : ScalarTypes) {
     if (ST->hasNonstandardName())
       continue;
     // We don't have float64x2_t
@@ -2190,6 +2509,10 @@ void EmitMveBuiltinSema(RecordKeeper &Records, raw_ostream &OS) {
   MveEmitter(Records).EmitBuiltinSema(OS);
 }
 
+void EmitMveBuiltinSemaTable(RecordKeeper &Records, raw_ostream &OS) {
+  MveEmitter(Records).EmitSemaCheckTable(OS, "mve");
+}
+
 void EmitMveBuiltinCG(RecordKeeper &Records, raw_ostream &OS) {
   MveEmitter(Records).EmitBuiltinCG(OS);
 }
@@ -2212,6 +2535,10 @@ void EmitCdeBuiltinSema(RecordKeeper &Records, raw_ostream &OS) {
   CdeEmitter(Records).EmitBuiltinSema(OS);
 }
 
+void EmitCdeBuiltinSemaTable(RecordKeeper &Records, raw_ostream &OS) {
+  CdeEmitter(Records).EmitSemaCheckTable(OS, "cde");
+}
+
 void EmitCdeBuiltinCG(RecordKeeper &Records, raw_ostream &OS) {
   CdeEmitter(Records).EmitBuiltinCG(OS);
 }
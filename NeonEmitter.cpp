@@ -31,9 +31,11 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Record.h"
@@ -45,9 +47,11 @@
 #include <cstdint>
 #include <deque>
 #include <map>
+#include <numeric>
 #include <set>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -58,7 +62,7 @@ namespace {
 // While globals are generally bad, this one allows us to perform assertions
 // liberally and somehow still trace them back to the def they indirectly
 // came from.
-static Record *CurrentRecord = nullptr;
+static thread_local Record *CurrentRecord = nullptr;
 static void assert_with_loc(bool Assertion, const std::string &Str) {
   if (!Assertion) {
     if (CurrentRecord)
@@ -112,21 +116,22 @@ class NeonEmitter;
 //===----------------------------------------------------------------------===//
 
 /// A TypeSpec is just a simple wrapper around a string, but gets its own type
-/// for strong typing purposes.
+/// for strong typing purposes. It refers into the string it was split from,
+/// which must outlive it.
 ///
 /// A TypeSpec can be used to create a type.
-class TypeSpec : public std::string {
+class TypeSpec : public StringRef {
 public:
+  TypeSpec() = default;
+  explicit TypeSpec(StringRef S) : StringRef(S) {}
+
   static std::vector<TypeSpec> fromTypeSpecs(StringRef Str) {
     std::vector<TypeSpec> Ret;
-    TypeSpec Acc;
-    for (char I : Str.str()) {
-      if (islower(I)) {
-        Acc.push_back(I);
-        Ret.push_back(TypeSpec(Acc));
-        Acc.clear();
-      } else {
-        Acc.push_back(I);
+    size_t Start = 0;
+    for (size_t I = 0, E = Str.size(); I != E; ++I) {
+      if (islower(Str[I])) {
+        Ret.push_back(TypeSpec(Str.slice(Start, I + 1)));
+        Start = I + 1;
       }
     }
     return Ret;
@@ -140,8 +145,6 @@ public:
 /// A Type. Not much more to say here.
 class Type {
 private:
-  TypeSpec TS;
-
   enum TypeKind {
     Void,
     Float,
@@ -165,16 +168,28 @@ public:
         Bitwidth(0), ElementBitwidth(0), NumVectors(0) {}
 
   Type(TypeSpec TS, StringRef CharMods)
-      : TS(std::move(TS)), Kind(Void), Immediate(false),
-        Constant(false), Pointer(false), ScalarForMangling(false),
-        NoManglingQ(false), Bitwidth(0), ElementBitwidth(0), NumVectors(0) {
-    applyModifiers(CharMods);
+      : Kind(Void), Immediate(false), Constant(false), Pointer(false),
+        ScalarForMangling(false), NoManglingQ(false), Bitwidth(0),
+        ElementBitwidth(0), NumVectors(0) {
+    applyModifiers(TS, CharMods);
   }
 
   /// Returns a type representing "void".
   static Type getVoid() { return Type(); }
 
-  bool operator==(const Type &Other) const { return str() == Other.str(); }
+  /// Two types are equal if they have the same C string representation, see
+  /// str(). Compare the fields that it is made of rather than the strings.
+  bool operator==(const Type &Other) const {
+    if (isVoid() || Other.isVoid())
+      return isVoid() == Other.isVoid();
+    if (Kind != Other.Kind || ElementBitwidth != Other.ElementBitwidth ||
+        Constant != Other.Constant || Pointer != Other.Pointer ||
+        isVector() != Other.isVector())
+      return false;
+    if (isVector() && getNumElements() != Other.getNumElements())
+      return false;
+    return std::max(NumVectors, 1U) == std::max(Other.NumVectors, 1U);
+  }
   bool operator!=(const Type &Other) const { return !operator==(Other); }
 
   //
@@ -277,9 +292,9 @@ private:
   /// Sets "Quad" to true if the "Q" or "H" modifiers were
   /// seen. This is needed by applyModifier as some modifiers
   /// only take effect if the type size was changed by "Q" or "H".
-  void applyTypespec(bool &Quad);
-  /// Applies prototype modifiers to the type.
-  void applyModifiers(StringRef Mods);
+  void applyTypespec(TypeSpec TS, bool &Quad);
+  /// Applies prototype modifiers to the type created from TS.
+  void applyModifiers(TypeSpec TS, StringRef Mods);
 };
 
 //===----------------------------------------------------------------------===//
@@ -289,14 +304,15 @@ private:
 /// A variable is a simple class that just has a type and a name.
 class Variable {
   Type T;
+  /// The name as emitted, with its "__" prefix.
   std::string N;
 
 public:
-  Variable() : T(Type::getVoid()) {}
-  Variable(Type T, std::string N) : T(std::move(T)), N(std::move(N)) {}
+  Variable() : T(Type::getVoid()), N("__") {}
+  Variable(Type T, StringRef N) : T(T), N(("__" + N).str()) {}
 
   Type getType() const { return T; }
-  std::string getName() const { return "__" + N; }
+  const std::string &getName() const { return N; }
 };
 
 //===----------------------------------------------------------------------===//
@@ -335,7 +351,7 @@ class Intrinsic {
   /// The index of the key type passed to CGBuiltin.cpp for polymorphic calls.
   int PolymorphicKeyType;
   /// The local variables defined.
-  std::map<std::string, Variable> Variables;
+  StringMap<Variable> Variables;
   /// NeededEarly - set if any other intrinsic depends on this intrinsic.
   bool NeededEarly;
   /// UseMacro - set if we should implement using a macro or unset for a
@@ -343,6 +359,10 @@ class Intrinsic {
   bool UseMacro;
   /// The set of intrinsics that this intrinsic uses/requires.
   std::set<Intrinsic *> Dependencies;
+  /// The intrinsic called by each call DAG in the body. The body is walked
+  /// once to index it and up to three more times to generate it, and resolves
+  /// to the same callees each time.
+  DenseMap<DagInit *, Intrinsic *> Callees;
   /// The "base type", which is Type('d', OutTS). InBaseType is only
   /// different if CartesianProductWith is non-empty (for vreinterpret).
   Type BaseType, InBaseType;
@@ -489,10 +509,10 @@ public:
 private:
   StringRef getNextModifiers(StringRef Proto, unsigned &Pos) const;
 
-  std::string mangleName(std::string Name, ClassKind CK) const;
+  std::string mangleName(StringRef Name, ClassKind CK) const;
 
   void initVariables();
-  std::string replaceParamsIn(std::string S);
+  std::string replaceParamsIn(StringRef S);
 
   void emitBodyAsBuiltinCall();
 
@@ -538,18 +558,53 @@ private:
 // NeonEmitter
 //===----------------------------------------------------------------------===//
 
+/// The overloaded type check of a builtin: the permitted types of its key
+/// argument, as a mask of NeonTypeFlags, and its pointer argument, if any.
+struct OverloadInfo {
+  uint64_t Mask;
+  int PtrArgNum;
+  bool HasConstPtr;
+  OverloadInfo() : Mask(0ULL), PtrArgNum(0), HasConstPtr(false) {}
+};
+
+/// The range check of the immediate argument of a builtin.
+struct ImmediateCheck {
+  /// How the upper bound is computed: either it is UpperBound, or it depends
+  /// on the type argument of an overloaded shift or lane builtin.
+  enum UpperBoundKind { Constant, Shift, Lane, LaneQ };
+
+  unsigned ArgIdx = 0;
+  Optional<unsigned> LowerBound;
+  unsigned UpperBound = 0;
+  UpperBoundKind Kind = Constant;
+};
+
 class NeonEmitter {
   RecordKeeper &Records;
   DenseMap<Record *, ClassKind> ClassMap;
-  std::map<std::string, std::deque<Intrinsic>> IntrinsicMap;
+  StringMap<std::deque<Intrinsic>> IntrinsicMap;
   unsigned UniqueNumber;
-
-  void createIntrinsic(Record *R, SmallVectorImpl<Intrinsic *> &Out);
-  void genBuiltinsDef(raw_ostream &OS, SmallVectorImpl<Intrinsic *> &Defs);
+  /// Every intrinsic created from the Inst records, in record order. These
+  /// are created on first use.
+  SmallVector<Intrinsic *, 128> Defs;
+  bool CreatedIntrinsics = false;
+  bool IndexedIntrinsics = false;
+  /// The elements of each shuffle mask, evaluated once per mask DAG and
+  /// vector shape (number of elements, element size) it is applied to.
+  std::map<std::tuple<Init *, unsigned, unsigned>, SmallVector<StringRef, 16>>
+      ShuffleMasks;
+
+  ArrayRef<Intrinsic *> getIntrinsics();
+  ArrayRef<Intrinsic *> getIndexedIntrinsics();
+
+  void createIntrinsic(Record *R, std::vector<Intrinsic> &Out);
+  void emitIntrinsics(ArrayRef<Intrinsic *> Intrinsics, raw_ostream &OS);
+  void genBuiltinsDef(raw_ostream &OS, ArrayRef<Intrinsic *> Defs);
   void genOverloadTypeCheckCode(raw_ostream &OS,
-                                SmallVectorImpl<Intrinsic *> &Defs);
+                                ArrayRef<Intrinsic *> Defs);
   void genIntrinsicRangeCheckCode(raw_ostream &OS,
-                                  SmallVectorImpl<Intrinsic *> &Defs);
+                                  ArrayRef<Intrinsic *> Defs);
+  void genSemaCheckTable(raw_ostream &OS, ArrayRef<Intrinsic *> Defs);
 
 public:
   /// Called by Intrinsic - this attempts to get an intrinsic that takes
@@ -560,6 +615,13 @@ public:
   /// Called by Intrinsic - returns a globally-unique number.
   unsigned getUniqueNumber() { return UniqueNumber++; }
 
+  /// Called by Intrinsic - returns the element numbers of the shuffle mask
+  /// Mask applied to vectors of type T, calling Evaluate to expand the mask
+  /// only the first time it is seen for that shape.
+  ArrayRef<StringRef>
+  getShuffleMask(Init *Mask, const Type &T,
+                 function_ref<void(SetTheory::RecSet &)> Evaluate);
+
   NeonEmitter(RecordKeeper &R) : Records(R), UniqueNumber(0) {
     Record *SI = R.getClass("SInst");
     Record *II = R.getClass("IInst");
@@ -592,6 +654,9 @@ public:
   // Emit all the __builtin prototypes used in arm_neon.h, arm_fp16.h and
   // arm_bf16.h
   void runHeader(raw_ostream &o);
+
+  // Emit the same as runHeader, with the Sema checks as a table
+  void runSemaTable(raw_ostream &o);
 };
 
 } // end anonymous namespace
@@ -787,14 +852,13 @@ Type Type::fromTypedefName(StringRef Name) {
   return T;
 }
 
-void Type::applyTypespec(bool &Quad) {
-  std::string S = TS;
+void Type::applyTypespec(TypeSpec TS, bool &Quad) {
   ScalarForMangling = false;
   Kind = SInt;
   ElementBitwidth = ~0U;
   NumVectors = 1;
 
-  for (char I : S) {
+  for (char I : TS) {
     switch (I) {
     case 'S':
       ScalarForMangling = true;
@@ -852,9 +916,9 @@ void Type::applyTypespec(bool &Quad) {
   Bitwidth = Quad ? 128 : 64;
 }
 
-void Type::applyModifiers(StringRef Mods) {
+void Type::applyModifiers(TypeSpec TS, StringRef Mods) {
   bool AppliedQuad = false;
-  applyTypespec(AppliedQuad);
+  applyTypespec(TS, AppliedQuad);
 
   for (char Mod : Mods) {
     switch (Mod) {
@@ -1054,19 +1118,22 @@ std::string Intrinsic::getMangledName(bool ForceClassS) const {
   return mangleName(Name, ForceClassS ? ClassS : LocalCK);
 }
 
-std::string Intrinsic::mangleName(std::string Name, ClassKind LocalCK) const {
-  std::string typeCode = getInstTypeCode(BaseType, LocalCK);
-  std::string S = Name;
-
+std::string Intrinsic::mangleName(StringRef Name, ClassKind LocalCK) const {
   if (Name == "vcvt_f16_f32" || Name == "vcvt_f32_f16" ||
       Name == "vcvt_f32_f64" || Name == "vcvt_f64_f32" ||
       Name == "vcvt_f32_bf16")
-    return Name;
+    return Name.str();
+
+  std::string typeCode = getInstTypeCode(BaseType, LocalCK);
+  std::string S;
+  // Room for the type codes, "_v" and the 'q' and scalar suffixes.
+  S.reserve(Name.size() + 16);
+  S += Name;
 
   if (!typeCode.empty()) {
     // If the name ends with _xN (N = 2,3,4), insert the typeCode before _xN.
     if (Name.size() >= 3 && isdigit(Name.back()) &&
-        Name[Name.length() - 2] == 'x' && Name[Name.length() - 3] == '_')
+        Name[Name.size() - 2] == 'x' && Name[Name.size() - 3] == '_')
       S.insert(S.length() - 3, "_" + typeCode);
     else
       S += "_" + typeCode;
@@ -1105,20 +1172,23 @@ std::string Intrinsic::mangleName(std::string Name, ClassKind LocalCK) const {
   return S;
 }
 
-std::string Intrinsic::replaceParamsIn(std::string S) {
-  while (S.find('$') != std::string::npos) {
-    size_t Pos = S.find('$');
+std::string Intrinsic::replaceParamsIn(StringRef S) {
+  std::string Ret;
+  Ret.reserve(S.size());
+  for (size_t Pos = S.find('$'); Pos != StringRef::npos; Pos = S.find('$')) {
     size_t End = Pos + 1;
-    while (isalpha(S[End]))
+    while (End != S.size() && isalpha(S[End]))
       ++End;
 
-    std::string VarName = S.substr(Pos + 1, End - Pos - 1);
-    assert_with_loc(Variables.find(VarName) != Variables.end(),
-                    "Variable not defined!");
-    S.replace(Pos, End - Pos, Variables.find(VarName)->second.getName());
+    auto It = Variables.find(S.slice(Pos + 1, End));
+    assert_with_loc(It != Variables.end(), "Variable not defined!");
+    Ret += S.take_front(Pos);
+    Ret += It->second.getName();
+    S = S.drop_front(End);
   }
+  Ret += S;
 
-  return S;
+  return Ret;
 }
 
 void Intrinsic::initVariables() {
@@ -1299,7 +1369,7 @@ void Intrinsic::emitBodyAsBuiltinCall() {
   if (!getReturnType().isVoid() && !SRet)
     S += "(" + RetVar.getType().str() + ") ";
 
-  S += "__builtin_neon_" + mangleName(std::string(N), LocalCK) + "(";
+  S += "__builtin_neon_" + mangleName(N, LocalCK) + "(";
 
   if (SRet)
     S += "&" + RetVar.getName() + ", ";
@@ -1457,19 +1527,23 @@ Intrinsic::DagEmitter::emitDagCall(DagInit *DI, bool MatchMangledName) {
     Values.push_back(R.second);
   }
 
-  // Look up the called intrinsic.
-  std::string N;
-  if (StringInit *SI = dyn_cast<StringInit>(DI->getArg(0)))
-    N = SI->getAsUnquotedString();
-  else
-    N = emitDagArg(DI->getArg(0), "").second;
-  Optional<std::string> MangledName;
-  if (MatchMangledName) {
-    if (Intr.getRecord()->getValueAsBit("isLaneQ"))
-      N += "q";
-    MangledName = Intr.mangleName(N, ClassS);
+  // Look up the called intrinsic, unless an earlier walk of the body has.
+  Intrinsic *&CalleePtr = Intr.Callees[DI];
+  if (!CalleePtr) {
+    std::string N;
+    if (StringInit *SI = dyn_cast<StringInit>(DI->getArg(0)))
+      N = SI->getAsUnquotedString();
+    else
+      N = emitDagArg(DI->getArg(0), "").second;
+    Optional<std::string> MangledName;
+    if (MatchMangledName) {
+      if (Intr.getRecord()->getValueAsBit("isLaneQ"))
+        N += "q";
+      MangledName = Intr.mangleName(N, ClassS);
+    }
+    CalleePtr = &Intr.Emitter.getIntrinsic(N, Types, MangledName);
   }
-  Intrinsic &Callee = Intr.Emitter.getIntrinsic(N, Types, MangledName);
+  Intrinsic &Callee = *CalleePtr;
 
   // Make sure the callee is known as an early def.
   Callee.setNeededEarly();
@@ -1507,11 +1581,9 @@ std::pair<Type, std::string> Intrinsic::DagEmitter::emitDagCast(DagInit *DI,
     //   5. The value "H" or "D" to half or double the bitwidth.
     //   6. The value "8" to convert to 8-bit (signed) integer lanes.
     if (!DI->getArgNameStr(ArgIdx).empty()) {
-      assert_with_loc(Intr.Variables.find(std::string(
-                          DI->getArgNameStr(ArgIdx))) != Intr.Variables.end(),
-                      "Variable not found");
-      castToType =
-          Intr.Variables[std::string(DI->getArgNameStr(ArgIdx))].getType();
+      auto It = Intr.Variables.find(DI->getArgNameStr(ArgIdx));
+      assert_with_loc(It != Intr.Variables.end(), "Variable not found");
+      castToType = It->second.getType();
     } else {
       StringInit *SI = dyn_cast<StringInit>(DI->getArg(ArgIdx));
       assert_with_loc(SI, "Expected string type or $Name for cast type");
@@ -1634,23 +1706,21 @@ std::pair<Type, std::string> Intrinsic::DagEmitter::emitDagShuffle(DagInit *DI){
   assert_with_loc(Arg1.first == Arg2.first,
                   "Different types in arguments to shuffle!");
 
-  SetTheory ST;
-  SetTheory::RecSet Elts;
-  ST.addOperator("lowhalf", std::make_unique<LowHalf>());
-  ST.addOperator("highhalf", std::make_unique<HighHalf>());
-  ST.addOperator("rev",
-                 std::make_unique<Rev>(Arg1.first.getElementSizeInBits()));
-  ST.addExpander("MaskExpand",
-                 std::make_unique<MaskExpander>(Arg1.first.getNumElements()));
-  ST.evaluate(DI->getArg(2), Elts, None);
+  ArrayRef<StringRef> Elts = Intr.Emitter.getShuffleMask(
+      DI->getArg(2), Arg1.first, [&](SetTheory::RecSet &Mask) {
+        SetTheory ST;
+        ST.addOperator("lowhalf", std::make_unique<LowHalf>());
+        ST.addOperator("highhalf", std::make_unique<HighHalf>());
+        ST.addOperator(
+            "rev", std::make_unique<Rev>(Arg1.first.getElementSizeInBits()));
+        ST.addExpander("MaskExpand", std::make_unique<MaskExpander>(
+                                         Arg1.first.getNumElements()));
+        ST.evaluate(DI->getArg(2), Mask, None);
+      });
 
   std::string S = "__builtin_shufflevector(" + Arg1.second + ", " + Arg2.second;
-  for (auto &E : Elts) {
-    StringRef Name = E->getName();
-    assert_with_loc(Name.startswith("sv"),
-                    "Incorrect element kind in shuffle mask!");
-    S += ", " + Name.drop_front(2).str();
-  }
+  for (StringRef E : Elts)
+    S += ", " + E.str();
   S += ")";
 
   // Recalculate the return type - the shuffle may have halved or doubled it.
@@ -1889,12 +1959,35 @@ void Intrinsic::indexBody() {
 Intrinsic &NeonEmitter::getIntrinsic(StringRef Name, ArrayRef<Type> Types,
                                      Optional<std::string> MangledName) {
   // First, look up the name in the intrinsic map.
-  assert_with_loc(IntrinsicMap.find(Name.str()) != IntrinsicMap.end(),
+  auto It = IntrinsicMap.find(Name);
+  assert_with_loc(It != IntrinsicMap.end(),
                   ("Intrinsic '" + Name + "' not found!").str());
-  auto &V = IntrinsicMap.find(Name.str())->second;
-  std::vector<Intrinsic *> GoodVec;
+  auto &V = It->second;
+  SmallVector<Intrinsic *, 2> GoodVec;
+
+  // Now, look through each intrinsic implementation and see if the types are
+  // compatible. Check the mangled name last, as it has to be built.
+  for (auto &I : V) {
+    if (I.getNumParams() != Types.size())
+      continue;
+
+    unsigned ArgNum = 0;
+    bool MatchingArgumentTypes = llvm::all_of(Types, [&](const auto &Type) {
+      return Type == I.getParamType(ArgNum++);
+    });
+    if (!MatchingArgumentTypes)
+      continue;
+
+    if (MangledName && MangledName != I.getMangledName(true))
+      continue;
+
+    GoodVec.push_back(&I);
+  }
+
+  if (GoodVec.size() == 1)
+    return *GoodVec.front();
 
-  // Create a string to print if we end up failing.
+  // Create a string to print as we are failing.
   std::string ErrMsg = "looking up intrinsic '" + Name.str() + "(";
   for (unsigned I = 0; I < Types.size(); ++I) {
     if (I != 0)
@@ -1903,9 +1996,6 @@ Intrinsic &NeonEmitter::getIntrinsic(StringRef Name, ArrayRef<Type> Types,
   }
   ErrMsg += ")'\n";
   ErrMsg += "Available overloads:\n";
-
-  // Now, look through each intrinsic implementation and see if the types are
-  // compatible.
   for (auto &I : V) {
     ErrMsg += "  - " + I.getReturnType().str() + " " + I.getMangledName();
     ErrMsg += "(";
@@ -1915,20 +2005,6 @@ Intrinsic &NeonEmitter::getIntrinsic(StringRef Name, ArrayRef<Type> Types,
       ErrMsg += I.getParamType(A).str();
     }
     ErrMsg += ")\n";
-
-    if (MangledName && MangledName != I.getMangledName(true))
-      continue;
-
-    if (I.getNumParams() != Types.size())
-      continue;
-
-    unsigned ArgNum = 0;
-    bool MatchingArgumentTypes = llvm::all_of(Types, [&](const auto &Type) {
-      return Type == I.getParamType(ArgNum++);
-    });
-
-    if (MatchingArgumentTypes)
-      GoodVec.push_back(&I);
   }
 
   assert_with_loc(!GoodVec.empty(),
@@ -1938,16 +2014,16 @@ Intrinsic &NeonEmitter::getIntrinsic(StringRef Name, ArrayRef<Type> Types,
   return *GoodVec.front();
 }
 
-void NeonEmitter::createIntrinsic(Record *R,
-                                  SmallVectorImpl<Intrinsic *> &Out) {
-  std::string Name = std::string(R->getValueAsString("Name"));
-  std::string Proto = std::string(R->getValueAsString("Prototype"));
-  std::string Types = std::string(R->getValueAsString("Types"));
+void NeonEmitter::createIntrinsic(Record *R, std::vector<Intrinsic> &Out) {
+  // The typespecs refer into these strings, which live as long as the record.
+  StringRef Name = R->getValueAsString("Name");
+  StringRef Proto = R->getValueAsString("Prototype");
+  StringRef Types = R->getValueAsString("Types");
   Record *OperationRec = R->getValueAsDef("Operation");
   bool BigEndianSafe  = R->getValueAsBit("BigEndianSafe");
-  std::string Guard = std::string(R->getValueAsString("ArchGuard"));
+  StringRef Guard = R->getValueAsString("ArchGuard");
   bool IsUnavailable = OperationRec->getValueAsBit("Unavailable");
-  std::string CartesianProductWith = std::string(R->getValueAsString("CartesianProductWith"));
+  StringRef CartesianProductWith = R->getValueAsString("CartesianProductWith");
 
   // Set the global current record. This allows assert_with_loc to produce
   // decent location information even when highly nested.
@@ -1959,7 +2035,7 @@ void NeonEmitter::createIntrinsic(Record *R,
 
   ClassKind CK = ClassNone;
   if (R->getSuperClasses().size() >= 2)
-    CK = ClassMap[R->getSuperClasses()[1].first];
+    CK = ClassMap.lookup(R->getSuperClasses()[1].first);
 
   std::vector<std::pair<TypeSpec, TypeSpec>> NewTypeSpecs;
   if (!CartesianProductWith.empty()) {
@@ -1983,21 +2059,156 @@ void NeonEmitter::createIntrinsic(Record *R,
   llvm::sort(NewTypeSpecs);
   NewTypeSpecs.erase(std::unique(NewTypeSpecs.begin(), NewTypeSpecs.end()),
 		     NewTypeSpecs.end());
-  auto &Entry = IntrinsicMap[Name];
+  Out.reserve(NewTypeSpecs.size());
+  for (auto &I : NewTypeSpecs)
+    Out.emplace_back(R, Name, Proto, I.first, I.second, CK, Body, *this,
+                     Guard, IsUnavailable, BigEndianSafe);
 
-  for (auto &I : NewTypeSpecs) {
-    Entry.emplace_back(R, Name, Proto, I.first, I.second, CK, Body, *this,
-                       Guard, IsUnavailable, BigEndianSafe);
-    Out.push_back(&Entry.back());
+  CurrentRecord = nullptr;
+}
+
+ArrayRef<StringRef>
+NeonEmitter::getShuffleMask(Init *Mask, const Type &T,
+                            function_ref<void(SetTheory::RecSet &)> Evaluate) {
+  auto Key = std::make_tuple(Mask, T.getNumElements(),
+                             T.getElementSizeInBits());
+  auto It = ShuffleMasks.find(Key);
+  if (It != ShuffleMasks.end())
+    return It->second;
+
+  SetTheory::RecSet Elts;
+  Evaluate(Elts);
+  SmallVector<StringRef, 16> Numbers;
+  for (auto *E : Elts) {
+    StringRef Name = E->getName();
+    assert_with_loc(Name.startswith("sv"),
+                    "Incorrect element kind in shuffle mask!");
+    Numbers.push_back(Name.drop_front(2));
   }
+  return ShuffleMasks.emplace(Key, std::move(Numbers)).first->second;
+}
 
-  CurrentRecord = nullptr;
+/// Create the intrinsics of every Inst record, if that has not been done yet.
+///
+/// Records are expanded independently of each other, on as many threads as
+/// -threads allows, and then registered in record order so that the result
+/// does not depend on the scheduling.
+ArrayRef<Intrinsic *> NeonEmitter::getIntrinsics() {
+  if (CreatedIntrinsics)
+    return Defs;
+  CreatedIntrinsics = true;
+
+  struct Expansion {
+    Record *R;
+    std::vector<Intrinsic> Intrinsics;
+  };
+  std::vector<Expansion> Expansions;
+  for (auto *R : Records.getAllDerivedDefinitions("Inst"))
+    Expansions.push_back({R, {}});
+
+  parallelForEach(Expansions,
+                  [&](Expansion &E) { createIntrinsic(E.R, E.Intrinsics); });
+
+  for (auto &E : Expansions) {
+    auto &Entry = IntrinsicMap[E.R->getValueAsString("Name")];
+    for (auto &I : E.Intrinsics) {
+      Entry.push_back(std::move(I));
+      Defs.push_back(&Entry.back());
+    }
+  }
+  return Defs;
+}
+
+/// Return the intrinsics with their bodies type checked and their dependency
+/// graph populated, ready to be emitted.
+ArrayRef<Intrinsic *> NeonEmitter::getIndexedIntrinsics() {
+  if (!IndexedIntrinsics) {
+    for (auto *I : getIntrinsics())
+      I->indexBody();
+    IndexedIntrinsics = true;
+  }
+  return Defs;
+}
+
+/// Emit the definitions of Intrinsics, each one after the intrinsics it
+/// depends on, wrapping them in their architectural guards.
+///
+/// Defs are emitted in rounds: each round walks the sorted list and emits
+/// every intrinsic whose dependencies have all been emitted by then. Rather
+/// than rescanning the list until nothing is left, compute the round of each
+/// intrinsic in a single topological walk of the dependency graph. An
+/// intrinsic goes out in the same round as a dependency that sorts before it,
+/// and one round later than a dependency that sorts after it.
+void NeonEmitter::emitIntrinsics(ArrayRef<Intrinsic *> Intrinsics,
+                                 raw_ostream &OS) {
+  SmallVector<Intrinsic *, 128> Defs(Intrinsics.begin(), Intrinsics.end());
+  llvm::stable_sort(Defs, llvm::deref<std::less<>>());
+
+  DenseMap<Intrinsic *, unsigned> Index;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+    Index[Defs[I]] = I;
+
+  // Dependencies that are not being emitted here are already satisfied.
+  std::vector<unsigned> NumPending(Defs.size()), Round(Defs.size());
+  std::vector<SmallVector<unsigned, 4>> Users(Defs.size());
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+    for (auto *Dep : Defs[I]->getDependencies()) {
+      auto It = Index.find(Dep);
+      if (It == Index.end())
+        continue;
+      Users[It->second].push_back(I);
+      ++NumPending[I];
+    }
+
+  SmallVector<unsigned, 128> Worklist;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+    if (!NumPending[I])
+      Worklist.push_back(I);
+  unsigned NumRounds = 1, NumScheduled = 0;
+  while (!Worklist.empty()) {
+    unsigned I = Worklist.pop_back_val();
+    ++NumScheduled;
+    for (unsigned User : Users[I]) {
+      Round[User] = std::max(Round[User], Round[I] + (I > User ? 1 : 0));
+      NumRounds = std::max(NumRounds, Round[User] + 1);
+      if (!--NumPending[User])
+        Worklist.push_back(User);
+    }
+  }
+  assert(NumScheduled == Defs.size() &&
+         "Some requirements were not satisfied!");
+
+  // Bucket the defs by round, keeping them sorted within each round.
+  std::vector<unsigned> RoundStart(NumRounds + 1);
+  for (unsigned R : Round)
+    ++RoundStart[R + 1];
+  std::partial_sum(RoundStart.begin(), RoundStart.end(), RoundStart.begin());
+  std::vector<Intrinsic *> Order(Defs.size());
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+    Order[RoundStart[Round[I]]++] = Defs[I];
+
+  std::string InGuard;
+  for (auto *I : Order) {
+    // Emit #endif/#if pair if needed.
+    if (I->getGuard() != InGuard) {
+      if (!InGuard.empty())
+        OS << "#endif\n";
+      InGuard = I->getGuard();
+      if (!InGuard.empty())
+        OS << "#if " << InGuard << "\n";
+    }
+
+    // Actually generate the intrinsic code.
+    OS << I->generate();
+  }
+  if (!InGuard.empty())
+    OS << "#endif\n";
 }
 
 /// genBuiltinsDef: Generate the BuiltinsARM.def and  BuiltinsAArch64.def
 /// declaration of builtins, checking for unique builtin declarations.
 void NeonEmitter::genBuiltinsDef(raw_ostream &OS,
-                                 SmallVectorImpl<Intrinsic *> &Defs) {
+                                 ArrayRef<Intrinsic *> Defs) {
   OS << "#ifdef GET_NEON_BUILTINS\n";
 
   // We only want to emit a builtin once, and we want to emit them in
@@ -2023,19 +2234,12 @@ void NeonEmitter::genBuiltinsDef(raw_ostream &OS,
 
 /// Generate the ARM and AArch64 overloaded type checking code for
 /// SemaChecking.cpp, checking for unique builtin declarations.
-void NeonEmitter::genOverloadTypeCheckCode(raw_ostream &OS,
-                                           SmallVectorImpl<Intrinsic *> &Defs) {
-  OS << "#ifdef GET_NEON_OVERLOAD_CHECK\n";
-
-  // We record each overload check line before emitting because subsequent Inst
+/// Compute the overloaded type check of each builtin, keyed by builtin name.
+static std::map<std::string, OverloadInfo>
+getOverloadChecks(ArrayRef<Intrinsic *> Defs) {
+  // We record each overload check before emitting because subsequent Inst
   // definitions may extend the number of permitted types (i.e. augment the
   // Mask). Use std::map to avoid sorting the table by hash number.
-  struct OverloadInfo {
-    uint64_t Mask;
-    int PtrArgNum;
-    bool HasConstPtr;
-    OverloadInfo() : Mask(0ULL), PtrArgNum(0), HasConstPtr(false) {}
-  };
   std::map<std::string, OverloadInfo> OverloadMap;
 
   for (auto *Def : Defs) {
@@ -2087,9 +2291,15 @@ void NeonEmitter::genOverloadTypeCheckCode(raw_ostream &OS,
       OI.HasConstPtr = HasConstPtr;
     }
   }
+  return OverloadMap;
+}
 
-  for (auto &I : OverloadMap) {
-    OverloadInfo &OI = I.second;
+void NeonEmitter::genOverloadTypeCheckCode(raw_ostream &OS,
+                                           ArrayRef<Intrinsic *> Defs) {
+  OS << "#ifdef GET_NEON_OVERLOAD_CHECK\n";
+
+  for (auto &I : getOverloadChecks(Defs)) {
+    const OverloadInfo &OI = I.second;
 
     OS << "case NEON::BI__builtin_neon_" << I.first << ": ";
     OS << "mask = 0x" << Twine::utohexstr(OI.Mask) << "ULL";
@@ -2102,10 +2312,11 @@ void NeonEmitter::genOverloadTypeCheckCode(raw_ostream &OS,
   OS << "#endif\n\n";
 }
 
-void NeonEmitter::genIntrinsicRangeCheckCode(raw_ostream &OS,
-                                        SmallVectorImpl<Intrinsic *> &Defs) {
-  OS << "#ifdef GET_NEON_IMMEDIATE_CHECK\n";
-
+/// Compute the immediate range check of each builtin, in the order the
+/// builtins are first defined.
+static std::vector<std::pair<std::string, ImmediateCheck>>
+getImmediateChecks(ArrayRef<Intrinsic *> Defs) {
+  std::vector<std::pair<std::string, ImmediateCheck>> Checks;
   std::set<std::string> Emitted;
 
   for (auto *Def : Defs) {
@@ -2118,70 +2329,158 @@ void NeonEmitter::genIntrinsicRangeCheckCode(raw_ostream &OS,
     if (Emitted.find(Def->getMangledName()) != Emitted.end())
       continue;
 
-    std::string LowerBound, UpperBound;
+    ImmediateCheck Check;
 
     Record *R = Def->getRecord();
     if (R->getValueAsBit("isVXAR")) {
       //VXAR takes an immediate in the range [0, 63]
-      LowerBound = "0";
-      UpperBound = "63";
+      Check.LowerBound = 0;
+      Check.UpperBound = 63;
     } else if (R->getValueAsBit("isVCVT_N")) {
       // VCVT between floating- and fixed-point values takes an immediate
       // in the range [1, 32) for f32 or [1, 64) for f64 or [1, 16) for f16.
-      LowerBound = "1";
+      Check.LowerBound = 1;
 	  if (Def->getBaseType().getElementSizeInBits() == 16 ||
 		  Def->getName().find('h') != std::string::npos)
 		// VCVTh operating on FP16 intrinsics in range [1, 16)
-		UpperBound = "15";
+		Check.UpperBound = 15;
 	  else if (Def->getBaseType().getElementSizeInBits() == 32)
-        UpperBound = "31";
+        Check.UpperBound = 31;
 	  else
-        UpperBound = "63";
+        Check.UpperBound = 63;
     } else if (R->getValueAsBit("isScalarShift")) {
       // Right shifts have an 'r' in the name, left shifts do not. Convert
       // instructions have the same bounds and right shifts.
       if (Def->getName().find('r') != std::string::npos ||
           Def->getName().find("cvt") != std::string::npos)
-        LowerBound = "1";
+        Check.LowerBound = 1;
 
-      UpperBound = utostr(Def->getReturnType().getElementSizeInBits() - 1);
+      Check.UpperBound = Def->getReturnType().getElementSizeInBits() - 1;
     } else if (R->getValueAsBit("isShift")) {
       // Builtins which are overloaded by type will need to have their upper
       // bound computed at Sema time based on the type constant.
 
       // Right shifts have an 'r' in the name, left shifts do not.
       if (Def->getName().find('r') != std::string::npos)
-        LowerBound = "1";
-      UpperBound = "RFT(TV, true)";
+        Check.LowerBound = 1;
+      Check.Kind = ImmediateCheck::Shift;
     } else if (Def->getClassKind(true) == ClassB) {
       // ClassB intrinsics have a type (and hence lane number) that is only
       // known at runtime.
       if (R->getValueAsBit("isLaneQ"))
-        UpperBound = "RFT(TV, false, true)";
+        Check.Kind = ImmediateCheck::LaneQ;
       else
-        UpperBound = "RFT(TV, false, false)";
+        Check.Kind = ImmediateCheck::Lane;
     } else {
       // The immediate generally refers to a lane in the preceding argument.
       assert(Def->getImmediateIdx() > 0);
       Type T = Def->getParamType(Def->getImmediateIdx() - 1);
-      UpperBound = utostr(T.getNumElements() - 1);
+      Check.UpperBound = T.getNumElements() - 1;
     }
 
     // Calculate the index of the immediate that should be range checked.
-    unsigned Idx = Def->getNumParams();
+    Check.ArgIdx = Def->getNumParams();
     if (Def->hasImmediate())
-      Idx = Def->getGeneratedParamIdx(Def->getImmediateIdx());
-
-    OS << "case NEON::BI__builtin_neon_" << Def->getMangledName() << ": "
-       << "i = " << Idx << ";";
-    if (!LowerBound.empty())
-      OS << " l = " << LowerBound << ";";
-    if (!UpperBound.empty())
-      OS << " u = " << UpperBound << ";";
-    OS << " break;\n";
+      Check.ArgIdx = Def->getGeneratedParamIdx(Def->getImmediateIdx());
 
+    Checks.emplace_back(Def->getMangledName(), Check);
     Emitted.insert(Def->getMangledName());
   }
+  return Checks;
+}
+
+/// Return the C expression for the upper bound of an immediate check.
+static std::string getUpperBound(const ImmediateCheck &Check) {
+  switch (Check.Kind) {
+  case ImmediateCheck::Constant:
+    return utostr(Check.UpperBound);
+  case ImmediateCheck::Shift:
+    return "RFT(TV, true)";
+  case ImmediateCheck::Lane:
+    return "RFT(TV, false, false)";
+  case ImmediateCheck::LaneQ:
+    return "RFT(TV, false, true)";
+  }
+  llvm_unreachable("Unknown immediate check kind");
+}
+
+void NeonEmitter::genIntrinsicRangeCheckCode(raw_ostream &OS,
+                                        ArrayRef<Intrinsic *> Defs) {
+  OS << "#ifdef GET_NEON_IMMEDIATE_CHECK\n";
+
+  for (auto &I : getImmediateChecks(Defs)) {
+    const ImmediateCheck &Check = I.second;
+    OS << "case NEON::BI__builtin_neon_" << I.first << ": "
+       << "i = " << Check.ArgIdx << ";";
+    if (Check.LowerBound)
+      OS << " l = " << *Check.LowerBound << ";";
+    OS << " u = " << getUpperBound(Check) << ";";
+    OS << " break;\n";
+  }
+
+  OS << "#endif\n\n";
+}
+
+/// Generate one row of Sema checks per builtin, in the same order as the
+/// builtins themselves, so that the rows of arm_neon.inc and arm_fp16.inc
+/// together form a table indexed by NEON builtin ID. A row holds the
+/// overloaded type check (mask 0 if there is none) and the immediate range
+/// check (argument -1 if there is none) of the builtin:
+///
+/// \code
+/// #ifdef GET_NEON_SEMA_CHECKS
+/// NEON_SEMA_CHECK(vget_lane_i8, 0x0ULL, -1, false, 1, 0, 7, Constant)
+/// NEON_SEMA_CHECK(vld1_v, 0x70307ULL, 0, true, -1, 0, 0, None)
+/// NEON_SEMA_CHECK(vshr_n_v, 0xf000fULL, -1, false, 1, 1, 0, Shift)
+/// #endif
+/// \endcode
+///
+/// The last column says how to compute the upper bound: Constant bounds are
+/// in the previous column, Shift, Lane and LaneQ bounds depend on the type
+/// argument as RFT(TV, true), RFT(TV, false, false) and RFT(TV, false, true).
+void NeonEmitter::genSemaCheckTable(raw_ostream &OS,
+                                    ArrayRef<Intrinsic *> Defs) {
+  OS << "#ifdef GET_NEON_SEMA_CHECKS\n";
+
+  std::map<std::string, OverloadInfo> OverloadChecks = getOverloadChecks(Defs);
+  std::map<std::string, ImmediateCheck> ImmediateChecks;
+  for (auto &I : getImmediateChecks(Defs))
+    ImmediateChecks.insert(I);
+
+  // The builtins, in the order genBuiltinsDef emits them.
+  std::set<std::string> Builtins;
+  for (auto *Def : Defs)
+    if (!Def->hasBody())
+      Builtins.insert(Def->getMangledName());
+
+  for (const std::string &Name : Builtins) {
+    OS << "NEON_SEMA_CHECK(" << Name << ", ";
+
+    auto OI = OverloadChecks.find(Name);
+    if (OI != OverloadChecks.end())
+      OS << "0x" << Twine::utohexstr(OI->second.Mask) << "ULL, "
+         << OI->second.PtrArgNum << ", "
+         << (OI->second.HasConstPtr ? "true" : "false") << ", ";
+    else
+      OS << "0x0ULL, -1, false, ";
+
+    auto II = ImmediateChecks.find(Name);
+    if (II != ImmediateChecks.end()) {
+      const ImmediateCheck &Check = II->second;
+      OS << Check.ArgIdx << ", "
+         << (Check.LowerBound ? *Check.LowerBound : 0) << ", "
+         << Check.UpperBound << ", ";
+      switch (Check.Kind) {
+      case ImmediateCheck::Constant: OS << "Constant"; break;
+      case ImmediateCheck::Shift: OS << "Shift"; break;
+      case ImmediateCheck::Lane: OS << "Lane"; break;
+      case ImmediateCheck::LaneQ: OS << "LaneQ"; break;
+      }
+    } else {
+      OS << "-1, 0, 0, None";
+    }
+    OS << ")\n";
+  }
 
   OS << "#endif\n\n";
 }
@@ -2191,11 +2490,7 @@ void NeonEmitter::genIntrinsicRangeCheckCode(raw_ostream &OS,
 /// 2. the SemaChecking code for the type overload checking.
 /// 3. the SemaChecking code for validation of intrinsic immediate arguments.
 void NeonEmitter::runHeader(raw_ostream &OS) {
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-
-  SmallVector<Intrinsic *, 128> Defs;
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
+  ArrayRef<Intrinsic *> Defs = getIntrinsics();
 
   // Generate shared BuiltinsXXX.def
   genBuiltinsDef(OS, Defs);
@@ -2207,6 +2502,14 @@ void NeonEmitter::runHeader(raw_ostream &OS) {
   genIntrinsicRangeCheckCode(OS, Defs);
 }
 
+/// runSemaTable - Emit the same file as runHeader, with the SemaChecking
+/// code of 2 and 3 replaced by a single table of checks.
+void NeonEmitter::runSemaTable(raw_ostream &OS) {
+  ArrayRef<Intrinsic *> Defs = getIntrinsics();
+  genBuiltinsDef(OS, Defs);
+  genSemaCheckTable(OS, Defs);
+}
+
 static void emitNeonTypeDefs(const std::string& types, raw_ostream &OS) {
   std::string TypedefTypes(types);
   std::vector<TypeSpec> TDTypeVec = TypeSpec::fromTypeSpecs(TypedefTypes);
@@ -2368,55 +2671,7 @@ void NeonEmitter::run(raw_ostream &OS) {
   OS << "#define __ai static __inline__ __attribute__((__always_inline__, "
         "__nodebug__))\n\n";
 
-  SmallVector<Intrinsic *, 128> Defs;
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
-
-  for (auto *I : Defs)
-    I->indexBody();
-
-  llvm::stable_sort(Defs, llvm::deref<std::less<>>());
-
-  // Only emit a def when its requirements have been met.
-  // FIXME: This loop could be made faster, but it's fast enough for now.
-  bool MadeProgress = true;
-  std::string InGuard;
-  while (!Defs.empty() && MadeProgress) {
-    MadeProgress = false;
-
-    for (SmallVector<Intrinsic *, 128>::iterator I = Defs.begin();
-         I != Defs.end(); /*No step*/) {
-      bool DependenciesSatisfied = true;
-      for (auto *II : (*I)->getDependencies()) {
-        if (llvm::is_contained(Defs, II))
-          DependenciesSatisfied = false;
-      }
-      if (!DependenciesSatisfied) {
-        // Try the next one.
-        ++I;
-        continue;
-      }
-
-      // Emit #endif/#if pair if needed.
-      if ((*I)->getGuard() != InGuard) {
-        if (!InGuard.empty())
-          OS << "#endif\n";
-        InGuard = (*I)->getGuard();
-        if (!InGuard.empty())
-          OS << "#if " << InGuard << "\n";
-      }
-
-      // Actually generate the intrinsic code.
-      OS << (*I)->generate();
-
-      MadeProgress = true;
-      I = Defs.erase(I);
-    }
-  }
-  assert(Defs.empty() && "Some requirements were not satisfied!");
-  if (!InGuard.empty())
-    OS << "#endif\n";
+  emitIntrinsics(getIndexedIntrinsics(), OS);
 
   OS << "\n";
   OS << "#undef __ai\n\n";
@@ -2477,55 +2732,7 @@ void NeonEmitter::runFP16(raw_ostream &OS) {
   OS << "#define __ai static __inline__ __attribute__((__always_inline__, "
         "__nodebug__))\n\n";
 
-  SmallVector<Intrinsic *, 128> Defs;
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
-
-  for (auto *I : Defs)
-    I->indexBody();
-
-  llvm::stable_sort(Defs, llvm::deref<std::less<>>());
-
-  // Only emit a def when its requirements have been met.
-  // FIXME: This loop could be made faster, but it's fast enough for now.
-  bool MadeProgress = true;
-  std::string InGuard;
-  while (!Defs.empty() && MadeProgress) {
-    MadeProgress = false;
-
-    for (SmallVector<Intrinsic *, 128>::iterator I = Defs.begin();
-         I != Defs.end(); /*No step*/) {
-      bool DependenciesSatisfied = true;
-      for (auto *II : (*I)->getDependencies()) {
-        if (llvm::is_contained(Defs, II))
-          DependenciesSatisfied = false;
-      }
-      if (!DependenciesSatisfied) {
-        // Try the next one.
-        ++I;
-        continue;
-      }
-
-      // Emit #endif/#if pair if needed.
-      if ((*I)->getGuard() != InGuard) {
-        if (!InGuard.empty())
-          OS << "#endif\n";
-        InGuard = (*I)->getGuard();
-        if (!InGuard.empty())
-          OS << "#if " << InGuard << "\n";
-      }
-
-      // Actually generate the intrinsic code.
-      OS << (*I)->generate();
-
-      MadeProgress = true;
-      I = Defs.erase(I);
-    }
-  }
-  assert(Defs.empty() && "Some requirements were not satisfied!");
-  if (!InGuard.empty())
-    OS << "#endif\n";
+  emitIntrinsics(getIndexedIntrinsics(), OS);
 
   OS << "\n";
   OS << "#undef __ai\n\n";
@@ -2554,55 +2761,7 @@ void NeonEmitter::runBF16(raw_ostream &OS) {
   OS << "#define __ai static __inline__ __attribute__((__always_inline__, "
         "__nodebug__))\n\n";
 
-  SmallVector<Intrinsic *, 128> Defs;
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
-
-  for (auto *I : Defs)
-    I->indexBody();
-
-  llvm::stable_sort(Defs, llvm::deref<std::less<>>());
-
-  // Only emit a def when its requirements have been met.
-  // FIXME: This loop could be made faster, but it's fast enough for now.
-  bool MadeProgress = true;
-  std::string InGuard;
-  while (!Defs.empty() && MadeProgress) {
-    MadeProgress = false;
-
-    for (SmallVector<Intrinsic *, 128>::iterator I = Defs.begin();
-         I != Defs.end(); /*No step*/) {
-      bool DependenciesSatisfied = true;
-      for (auto *II : (*I)->getDependencies()) {
-        if (llvm::is_contained(Defs, II))
-          DependenciesSatisfied = false;
-      }
-      if (!DependenciesSatisfied) {
-        // Try the next one.
-        ++I;
-        continue;
-      }
-
-      // Emit #endif/#if pair if needed.
-      if ((*I)->getGuard() != InGuard) {
-        if (!InGuard.empty())
-          OS << "#endif\n";
-        InGuard = (*I)->getGuard();
-        if (!InGuard.empty())
-          OS << "#if " << InGuard << "\n";
-      }
-
-      // Actually generate the intrinsic code.
-      OS << (*I)->generate();
-
-      MadeProgress = true;
-      I = Defs.erase(I);
-    }
-  }
-  assert(Defs.empty() && "Some requirements were not satisfied!");
-  if (!InGuard.empty())
-    OS << "#endif\n";
+  emitIntrinsics(getIndexedIntrinsics(), OS);
 
   OS << "\n";
   OS << "#undef __ai\n\n";
@@ -2622,10 +2781,38 @@ void clang::EmitBF16(RecordKeeper &Records, raw_ostream &OS) {
   NeonEmitter(Records).runBF16(OS);
 }
 
+/// Emit the header that Run writes to OS and, from the same expansion of the
+/// intrinsics, the outputs of runHeader and runSemaTable to the streams that
+/// are given.
+static void emitWithSema(RecordKeeper &Records, raw_ostream &OS,
+                         void (NeonEmitter::*Run)(raw_ostream &),
+                         raw_ostream *SemaOS, raw_ostream *SemaTableOS) {
+  NeonEmitter Emitter(Records);
+  if (SemaOS)
+    Emitter.runHeader(*SemaOS);
+  if (SemaTableOS)
+    Emitter.runSemaTable(*SemaTableOS);
+  (Emitter.*Run)(OS);
+}
+
+void clang::EmitNeonWithSema(RecordKeeper &Records, raw_ostream &OS,
+                             raw_ostream *SemaOS, raw_ostream *SemaTableOS) {
+  emitWithSema(Records, OS, &NeonEmitter::run, SemaOS, SemaTableOS);
+}
+
+void clang::EmitFP16WithSema(RecordKeeper &Records, raw_ostream &OS,
+                             raw_ostream *SemaOS, raw_ostream *SemaTableOS) {
+  emitWithSema(Records, OS, &NeonEmitter::runFP16, SemaOS, SemaTableOS);
+}
+
 void clang::EmitNeonSema(RecordKeeper &Records, raw_ostream &OS) {
   NeonEmitter(Records).runHeader(OS);
 }
 
+void clang::EmitNeonSemaTable(RecordKeeper &Records, raw_ostream &OS) {
+  NeonEmitter(Records).runSemaTable(OS);
+}
+
 void clang::EmitNeonTest(RecordKeeper &Records, raw_ostream &OS) {
   llvm_unreachable("Neon test generation no longer implemented!");
 }
@@ -16,14 +16,17 @@
 
 #include "clang/Support/RISCVVIntrinsicUtils.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Record.h"
+#include <map>
 #include <numeric>
 
 using namespace llvm;
@@ -72,11 +75,78 @@ struct SemaRecord {
   uint8_t MaskedPolicyScheme : 2;
 };
 
+// An RVVBuiltin record with the types of all of its intrinsics resolved.
+// Resolving types goes through the cache in RVVType, which is not thread safe,
+// so plans are made on one thread. Creating the intrinsics from a plan does
+// not touch the cache.
+struct RVVIntrinsicPlan {
+  // The types of the intrinsics for one basic type and LMUL.
+  struct Variant {
+    std::string SuffixStr;
+    std::string OverloadedSuffixStr;
+    RVVTypes Types;
+    // One per supported unmasked policy, if the record has a policy scheme.
+    SmallVector<RVVTypes, 2> UnMaskedPolicyTypes;
+    // Only set if the record has a masked intrinsic.
+    RVVTypes MaskTypes;
+    // One per supported masked policy, if the record has a policy scheme.
+    SmallVector<RVVTypes, 6> MaskedPolicyTypes;
+  };
+
+  StringRef Name;
+  StringRef OverloadedName;
+  StringRef IRName;
+  StringRef MaskedIRName;
+  StringRef ManualCodegen;
+  StringRef MaskedManualCodegen;
+  bool HasMasked;
+  bool HasMaskedOffOperand;
+  bool HasVL;
+  bool SupportOverloading;
+  bool HasBuiltinAlias;
+  bool IsPrototypeDefaultTU;
+  PolicyScheme UnMaskedPolicyScheme;
+  PolicyScheme MaskedPolicyScheme;
+  std::vector<int64_t> IntrinsicTypes;
+  std::vector<StringRef> RequiredFeatures;
+  unsigned NF;
+  SmallVector<Policy> SupportedUnMaskedPolicies;
+  SmallVector<Policy> SupportedMaskedPolicies;
+  std::vector<Variant> Variants;
+};
+
 // Compressed function signature table.
 class SemaSignatureTable {
 private:
   std::vector<PrototypeDescriptor> SignatureTable;
 
+  // A state of the suffix automaton of SignatureTable. Each state stands for
+  // a set of substrings of the table that end at the same positions.
+  struct State {
+    State(unsigned Len, int Link, unsigned FirstEnd)
+        : Len(Len), Link(Link), FirstEnd(FirstEnd) {}
+
+    // Length of the longest substring of the state.
+    unsigned Len;
+    // Suffix link, or -1 for the initial state.
+    int Link;
+    // Position in the table where the substrings of the state first end.
+    unsigned FirstEnd;
+    SmallDenseMap<uint32_t, unsigned, 4> Next;
+  };
+
+  // The suffix automaton, with the initial state first. It is extended with
+  // each descriptor appended to SignatureTable, and finds where a signature
+  // occurs in the table in time linear in the length of the signature.
+  std::vector<State> States = {State(0, -1, 0)};
+  unsigned LastState = 0;
+
+  static uint32_t getKey(const PrototypeDescriptor &PD) {
+    return static_cast<uint32_t>(PD.PT) << 16 |
+           static_cast<uint32_t>(PD.VTM) << 8 | static_cast<uint32_t>(PD.TM);
+  }
+
+  void append(const PrototypeDescriptor &PD);
   void insert(ArrayRef<PrototypeDescriptor> Signature);
 
 public:
@@ -96,6 +166,23 @@ class RVVEmitter {
 private:
   RecordKeeper &Records;
 
+  /// Produces the intrinsics of the RVVBuiltin records one at a time. Only
+  /// the intrinsics of the record being expanded are kept in memory.
+  class RVVIntrinsicStream {
+    RVVEmitter &Emitter;
+    std::vector<Record *> Builtins;
+    size_t NextBuiltin = 0;
+    std::vector<std::unique_ptr<RVVIntrinsic>> Pending;
+    size_t NextPending = 0;
+
+  public:
+    RVVIntrinsicStream(RVVEmitter &Emitter);
+
+    /// Return the next intrinsic, or nullptr once all of them have been
+    /// produced. The intrinsic is only valid until the following call.
+    const RVVIntrinsic *next();
+  };
+
 public:
   RVVEmitter(RecordKeeper &R) : Records(R) {}
 
@@ -114,9 +201,22 @@ public:
   void createSema(raw_ostream &o);
 
 private:
-  /// Create all intrinsics and add them to \p Out and SemaRecords.
-  void createRVVIntrinsics(std::vector<std::unique_ptr<RVVIntrinsic>> &Out,
-                           std::vector<SemaRecord> *SemaRecords = nullptr);
+  /// Create all intrinsics and add them to \p Out.
+  void createRVVIntrinsics(std::vector<std::unique_ptr<RVVIntrinsic>> &Out);
+  /// Create the intrinsics of the RVVBuiltin \p R and add them to \p Out.
+  void createRVVIntrinsics(Record *R,
+                           std::vector<std::unique_ptr<RVVIntrinsic>> &Out);
+  /// Read the RVVBuiltin \p R and resolve the types of its intrinsics.
+  void planRVVIntrinsics(Record *R, RVVIntrinsicPlan &Plan);
+  /// Create the intrinsics described by \p P and add them to \p Out. This
+  /// may run on several plans concurrently.
+  static void
+  createRVVIntrinsics(const RVVIntrinsicPlan &P,
+                      std::vector<std::unique_ptr<RVVIntrinsic>> &Out);
+  /// Create a SemaRecord for each RVVBuiltin record and add it to \p Out.
+  /// SemaRecords are read straight from the records, without creating any
+  /// intrinsics.
+  void createSemaRecords(std::vector<SemaRecord> &Out);
   /// Create all intrinsic records and SemaSignatureTable from SemaRecords.
   void createRVVIntrinsicRecords(std::vector<RVVIntrinsicRecord> &Out,
                                  SemaSignatureTable &SST,
@@ -231,52 +331,144 @@ void emitCodeGenSwitchBody(const RVVIntrinsic *RVVI, raw_ostream &OS) {
 // SemaSignatureTable implementation
 //===----------------------------------------------------------------------===//
 void SemaSignatureTable::init(ArrayRef<SemaRecord> SemaRecords) {
+  assert(!SemaRecords.empty());
+
+  std::vector<ArrayRef<PrototypeDescriptor>> Signatures;
+  for (const SemaRecord &SR : SemaRecords)
+    for (ArrayRef<PrototypeDescriptor> Sig :
+         {makeArrayRef(SR.Prototype), makeArrayRef(SR.Suffix),
+          makeArrayRef(SR.OverloadedSuffix)})
+      if (!Sig.empty())
+        Signatures.push_back(Sig);
+
   // Sort signature entries by length, let longer signature insert first, to
   // make it more possible to reuse table entries, that can reduce ~10% table
   // size.
-  struct Compare {
-    bool operator()(const SmallVector<PrototypeDescriptor> &A,
-                    const SmallVector<PrototypeDescriptor> &B) const {
-      if (A.size() != B.size())
-        return A.size() > B.size();
-
-      size_t Len = A.size();
-      for (size_t i = 0; i < Len; ++i) {
-        if (A[i] != B[i])
-          return A[i] < B[i];
-      }
+  llvm::sort(Signatures, [](ArrayRef<PrototypeDescriptor> A,
+                            ArrayRef<PrototypeDescriptor> B) {
+    if (A.size() != B.size())
+      return A.size() > B.size();
+    return std::lexicographical_compare(A.begin(), A.end(), B.begin(),
+                                        B.end());
+  });
+  Signatures.erase(std::unique(Signatures.begin(), Signatures.end(),
+                               [](ArrayRef<PrototypeDescriptor> A,
+                                  ArrayRef<PrototypeDescriptor> B) {
+                                 return A.equals(B);
+                               }),
+                   Signatures.end());
+  if (Signatures.empty())
+    return;
 
-      return false;
-    }
+  // Greedily append the signature whose prefix overlaps the end of the table
+  // the most, preferring the earliest signature on ties. Signatures are
+  // indexed by each of their proper prefixes to find it without scanning.
+  struct Candidates {
+    std::vector<unsigned> Indices;
+    size_t Next = 0;
+  };
+  auto PrefixLess = [](ArrayRef<PrototypeDescriptor> A,
+                       ArrayRef<PrototypeDescriptor> B) {
+    return std::lexicographical_compare(A.begin(), A.end(), B.begin(),
+                                        B.end());
+  };
+  std::map<ArrayRef<PrototypeDescriptor>, Candidates, decltype(PrefixLess)>
+      ByPrefix(PrefixLess);
+  for (unsigned I = 0; I < Signatures.size(); ++I)
+    for (size_t Len = 1; Len < Signatures[I].size(); ++Len)
+      ByPrefix[Signatures[I].take_front(Len)].Indices.push_back(I);
+
+  std::vector<bool> Done(Signatures.size());
+  // Return whether signature I still has to be placed.
+  auto IsPending = [&](unsigned I) {
+    if (!Done[I] && getIndex(Signatures[I]) != INVALID_INDEX)
+      Done[I] = true;
+    return !Done[I];
   };
 
-  std::set<SmallVector<PrototypeDescriptor>, Compare> Signatures;
-  auto InsertToSignatureSet =
-      [&](const SmallVector<PrototypeDescriptor> &Signature) {
-        if (Signature.empty())
-          return;
+  size_t NextInOrder = 0;
+  while (true) {
+    Optional<unsigned> Pick;
+    size_t MaxOverlap = std::min(Signatures.front().size() - 1,
+                                 SignatureTable.size());
+    for (size_t Overlap = MaxOverlap; Overlap > 0 && !Pick; --Overlap) {
+      auto It = ByPrefix.find(makeArrayRef(SignatureTable).take_back(Overlap));
+      if (It == ByPrefix.end())
+        continue;
+      Candidates &C = It->second;
+      while (C.Next < C.Indices.size() && !IsPending(C.Indices[C.Next]))
+        ++C.Next;
+      if (C.Next < C.Indices.size())
+        Pick = C.Indices[C.Next];
+    }
 
-        Signatures.insert(Signature);
-      };
+    if (!Pick) {
+      while (NextInOrder < Signatures.size() && !IsPending(NextInOrder))
+        ++NextInOrder;
+      if (NextInOrder == Signatures.size())
+        break;
+      Pick = NextInOrder;
+    }
 
-  assert(!SemaRecords.empty());
+    insert(Signatures[*Pick]);
+    Done[*Pick] = true;
+  }
+}
 
-  llvm::for_each(SemaRecords, [&](const SemaRecord &SR) {
-    InsertToSignatureSet(SR.Prototype);
-    InsertToSignatureSet(SR.Suffix);
-    InsertToSignatureSet(SR.OverloadedSuffix);
-  });
+void SemaSignatureTable::append(const PrototypeDescriptor &PD) {
+  // The standard online construction of a suffix automaton, which also
+  // records where the substrings of each state first end.
+  uint32_t Key = getKey(PD);
+  unsigned Cur = States.size();
+  States.emplace_back(States[LastState].Len + 1, -1, SignatureTable.size());
+  SignatureTable.push_back(PD);
+
+  int P = LastState;
+  while (P != -1 && !States[P].Next.count(Key)) {
+    States[P].Next[Key] = Cur;
+    P = States[P].Link;
+  }
+  LastState = Cur;
+  if (P == -1) {
+    States[Cur].Link = 0;
+    return;
+  }
 
-  llvm::for_each(Signatures, [this](auto &Sig) { insert(Sig); });
+  unsigned Q = States[P].Next[Key];
+  if (States[P].Len + 1 == States[Q].Len) {
+    States[Cur].Link = Q;
+    return;
+  }
+
+  unsigned Clone = States.size();
+  State CloneState = States[Q];
+  CloneState.Len = States[P].Len + 1;
+  States.push_back(std::move(CloneState));
+  while (P != -1) {
+    auto It = States[P].Next.find(Key);
+    if (It == States[P].Next.end() || It->second != Q)
+      break;
+    It->second = Clone;
+    P = States[P].Link;
+  }
+  States[Q].Link = Clone;
+  States[Cur].Link = Clone;
 }
 
 void SemaSignatureTable::insert(ArrayRef<PrototypeDescriptor> Signature) {
   if (getIndex(Signature) != INVALID_INDEX)
     return;
 
-  // Insert Signature into SignatureTable if not found in the table.
-  SignatureTable.insert(SignatureTable.begin(), Signature.begin(),
-                        Signature.end());
+  // Append the Signature, overlapping its longest prefix that the table
+  // already ends with.
+  size_t Overlap = std::min(Signature.size() - 1, SignatureTable.size());
+  for (; Overlap > 0; --Overlap)
+    if (std::equal(Signature.begin(), Signature.begin() + Overlap,
+                   SignatureTable.end() - Overlap))
+      break;
+
+  for (const PrototypeDescriptor &PD : Signature.drop_front(Overlap))
+    append(PD);
 }
 
 unsigned SemaSignatureTable::getIndex(ArrayRef<PrototypeDescriptor> Signature) {
@@ -285,17 +477,17 @@ unsigned SemaSignatureTable::getIndex(ArrayRef<PrototypeDescriptor> Signature) {
   if (Signature.empty())
     return 0;
 
-  // Checking Signature already in table or not.
-  if (Signature.size() < SignatureTable.size()) {
-    size_t Bound = SignatureTable.size() - Signature.size() + 1;
-    for (size_t Index = 0; Index < Bound; ++Index) {
-      if (equal(Signature.begin(), Signature.end(),
-                SignatureTable.begin() + Index))
-        return Index;
-    }
+  // Follow the Signature through the automaton; if it is in the table, the
+  // state it reaches knows where it first ends.
+  unsigned S = 0;
+  for (const PrototypeDescriptor &PD : Signature) {
+    auto It = States[S].Next.find(getKey(PD));
+    if (It == States[S].Next.end())
+      return INVALID_INDEX;
+    S = It->second;
   }
 
-  return INVALID_INDEX;
+  return States[S].FirstEnd + 1 - Signature.size();
 }
 
 void SemaSignatureTable::print(raw_ostream &OS) {
@@ -305,6 +497,26 @@ void SemaSignatureTable::print(raw_ostream &OS) {
        << "),\n";
 }
 
+//===----------------------------------------------------------------------===//
+// RVVIntrinsicStream implementation
+//===----------------------------------------------------------------------===//
+RVVEmitter::RVVIntrinsicStream::RVVIntrinsicStream(RVVEmitter &Emitter)
+    : Emitter(Emitter),
+      Builtins(Emitter.Records.getAllDerivedDefinitions("RVVBuiltin")) {}
+
+const RVVIntrinsic *RVVEmitter::RVVIntrinsicStream::next() {
+  // Expand the next record once the intrinsics of the previous one are used
+  // up. Records that produce no intrinsics are skipped.
+  while (NextPending == Pending.size()) {
+    if (NextBuiltin == Builtins.size())
+      return nullptr;
+    Pending.clear();
+    NextPending = 0;
+    Emitter.createRVVIntrinsics(Builtins[NextBuiltin++], Pending);
+  }
+  return Pending[NextPending++].get();
+}
+
 //===----------------------------------------------------------------------===//
 // RVVEmitter implementation
 //===----------------------------------------------------------------------===//
@@ -406,31 +618,37 @@ void RVVEmitter::createHeader(raw_ostream &OS) {
 }
 
 void RVVEmitter::createBuiltins(raw_ostream &OS) {
-  std::vector<std::unique_ptr<RVVIntrinsic>> Defs;
-  createRVVIntrinsics(Defs);
-
-  // Map to keep track of which builtin names have already been emitted.
-  StringMap<RVVIntrinsic *> BuiltinMap;
+  // Map to keep track of which builtin names have already been emitted, and
+  // what they were emitted with. The intrinsics are streamed, so the map
+  // keeps its own copy rather than pointing at them.
+  struct EmittedBuiltin {
+    bool HasBuiltinAlias;
+    std::string TypeStr;
+  };
+  StringMap<EmittedBuiltin> BuiltinMap;
 
   OS << "#if defined(TARGET_BUILTIN) && !defined(RISCVV_BUILTIN)\n";
   OS << "#define RISCVV_BUILTIN(ID, TYPE, ATTRS) TARGET_BUILTIN(ID, TYPE, "
         "ATTRS, \"zve32x\")\n";
   OS << "#endif\n";
-  for (auto &Def : Defs) {
-    auto P =
-        BuiltinMap.insert(std::make_pair(Def->getBuiltinName(), Def.get()));
+  RVVIntrinsicStream Stream(*this);
+  while (const RVVIntrinsic *Def = Stream.next()) {
+    auto P = BuiltinMap.try_emplace(Def->getBuiltinName());
+    EmittedBuiltin &Emitted = P.first->second;
     if (!P.second) {
       // Verf that this would have produced the same builtin definition.
-      if (P.first->second->hasBuiltinAlias() != Def->hasBuiltinAlias())
+      if (Emitted.HasBuiltinAlias != Def->hasBuiltinAlias())
         PrintFatalError("Builtin with same name has different hasAutoDef");
       else if (!Def->hasBuiltinAlias() &&
-               P.first->second->getBuiltinTypeStr() != Def->getBuiltinTypeStr())
+               Emitted.TypeStr != Def->getBuiltinTypeStr())
         PrintFatalError("Builtin with same name has different type string");
       continue;
     }
-    OS << "RISCVV_BUILTIN(__builtin_rvv_" << Def->getBuiltinName() << ",\"";
+    Emitted.HasBuiltinAlias = Def->hasBuiltinAlias();
     if (!Def->hasBuiltinAlias())
-      OS << Def->getBuiltinTypeStr();
+      Emitted.TypeStr = Def->getBuiltinTypeStr();
+    OS << "RISCVV_BUILTIN(__builtin_rvv_" << Def->getBuiltinName() << ",\"";
+    OS << Emitted.TypeStr;
     OS << "\", \"n\")\n";
   }
   OS << "#undef RISCVV_BUILTIN\n";
@@ -490,143 +708,215 @@ void RVVEmitter::createCodeGen(raw_ostream &OS) {
 }
 
 void RVVEmitter::createRVVIntrinsics(
-    std::vector<std::unique_ptr<RVVIntrinsic>> &Out,
-    std::vector<SemaRecord> *SemaRecords) {
+    std::vector<std::unique_ptr<RVVIntrinsic>> &Out) {
   std::vector<Record *> RV = Records.getAllDerivedDefinitions("RVVBuiltin");
-  for (auto *R : RV) {
-    StringRef Name = R->getValueAsString("Name");
-    StringRef SuffixProto = R->getValueAsString("Suffix");
-    StringRef OverloadedName = R->getValueAsString("OverloadedName");
-    StringRef OverloadedSuffixProto = R->getValueAsString("OverloadedSuffix");
-    StringRef Prototypes = R->getValueAsString("Prototype");
-    StringRef TypeRange = R->getValueAsString("TypeRange");
-    bool HasMasked = R->getValueAsBit("HasMasked");
-    bool HasMaskedOffOperand = R->getValueAsBit("HasMaskedOffOperand");
-    bool HasVL = R->getValueAsBit("HasVL");
-    Record *MPSRecord = R->getValueAsDef("MaskedPolicyScheme");
-    auto MaskedPolicyScheme =
-        static_cast<PolicyScheme>(MPSRecord->getValueAsInt("Value"));
-    Record *UMPSRecord = R->getValueAsDef("UnMaskedPolicyScheme");
-    auto UnMaskedPolicyScheme =
-        static_cast<PolicyScheme>(UMPSRecord->getValueAsInt("Value"));
-    std::vector<int64_t> Log2LMULList = R->getValueAsListOfInts("Log2LMUL");
-    bool HasTailPolicy = R->getValueAsBit("HasTailPolicy");
-    bool HasMaskPolicy = R->getValueAsBit("HasMaskPolicy");
-    bool IsPrototypeDefaultTU = R->getValueAsBit("IsPrototypeDefaultTU");
-    bool SupportOverloading = R->getValueAsBit("SupportOverloading");
-    bool HasBuiltinAlias = R->getValueAsBit("HasBuiltinAlias");
-    StringRef ManualCodegen = R->getValueAsString("ManualCodegen");
-    StringRef MaskedManualCodegen = R->getValueAsString("MaskedManualCodegen");
-    std::vector<int64_t> IntrinsicTypes =
-        R->getValueAsListOfInts("IntrinsicTypes");
-    std::vector<StringRef> RequiredFeatures =
-        R->getValueAsListOfStrings("RequiredFeatures");
-    StringRef IRName = R->getValueAsString("IRName");
-    StringRef MaskedIRName = R->getValueAsString("MaskedIRName");
-    unsigned NF = R->getValueAsInt("NF");
-
-    // If unmasked builtin supports policy, they should be TU or TA.
-    SmallVector<Policy> SupportedUnMaskedPolicies = {Policy::TU, Policy::TA};
-    SmallVector<Policy> SupportedMaskedPolicies =
-        RVVIntrinsic::getSupportedMaskedPolicies(HasTailPolicy, HasMaskPolicy);
-
-    // Parse prototype and create a list of primitive type with transformers
-    // (operand) in Prototype. Prototype[0] is output operand.
-    SmallVector<PrototypeDescriptor> BasicPrototype =
-        parsePrototypes(Prototypes);
-
-    SmallVector<PrototypeDescriptor> SuffixDesc = parsePrototypes(SuffixProto);
-    SmallVector<PrototypeDescriptor> OverloadedSuffixDesc =
-        parsePrototypes(OverloadedSuffixProto);
-
-    // Compute Builtin types
-    auto Prototype = RVVIntrinsic::computeBuiltinTypes(
-        BasicPrototype, /*IsMasked=*/false,
-        /*HasMaskedOffOperand=*/false, HasVL, NF, IsPrototypeDefaultTU,
-        UnMaskedPolicyScheme);
-    auto MaskedPrototype = RVVIntrinsic::computeBuiltinTypes(
-        BasicPrototype, /*IsMasked=*/true, HasMaskedOffOperand, HasVL, NF,
-        IsPrototypeDefaultTU, MaskedPolicyScheme);
-
-    // Create Intrinsics for each type and LMUL.
-    for (char I : TypeRange) {
-      for (int Log2LMUL : Log2LMULList) {
-        BasicType BT = ParseBasicType(I);
-        Optional<RVVTypes> Types =
-            RVVType::computeTypes(BT, Log2LMUL, NF, Prototype);
-        // Ignored to create new intrinsic if there are any illegal types.
-        if (!Types)
-          continue;
-
-        auto SuffixStr = RVVIntrinsic::getSuffixStr(BT, Log2LMUL, SuffixDesc);
-        auto OverloadedSuffixStr =
-            RVVIntrinsic::getSuffixStr(BT, Log2LMUL, OverloadedSuffixDesc);
-        // Create a unmasked intrinsic
-        Out.push_back(std::make_unique<RVVIntrinsic>(
-            Name, SuffixStr, OverloadedName, OverloadedSuffixStr, IRName,
-            /*IsMasked=*/false, /*HasMaskedOffOperand=*/false, HasVL,
-            UnMaskedPolicyScheme, SupportOverloading, HasBuiltinAlias,
-            ManualCodegen, *Types, IntrinsicTypes, RequiredFeatures, NF,
-            Policy::PolicyNone, IsPrototypeDefaultTU));
-        if (UnMaskedPolicyScheme != PolicyScheme::SchemeNone)
-          for (auto P : SupportedUnMaskedPolicies) {
-            SmallVector<PrototypeDescriptor> PolicyPrototype =
-                RVVIntrinsic::computeBuiltinTypes(
-                    BasicPrototype, /*IsMasked=*/false,
-                    /*HasMaskedOffOperand=*/false, HasVL, NF,
-                    IsPrototypeDefaultTU, UnMaskedPolicyScheme, P);
-            Optional<RVVTypes> PolicyTypes =
-                RVVType::computeTypes(BT, Log2LMUL, NF, PolicyPrototype);
-            Out.push_back(std::make_unique<RVVIntrinsic>(
-                Name, SuffixStr, OverloadedName, OverloadedSuffixStr, IRName,
-                /*IsMask=*/false, /*HasMaskedOffOperand=*/false, HasVL,
-                UnMaskedPolicyScheme, SupportOverloading, HasBuiltinAlias,
-                ManualCodegen, PolicyTypes.getValue(), IntrinsicTypes,
-                RequiredFeatures, NF, P, IsPrototypeDefaultTU));
-          }
-        if (!HasMasked)
-          continue;
-        // Create a masked intrinsic
-        Optional<RVVTypes> MaskTypes =
-            RVVType::computeTypes(BT, Log2LMUL, NF, Prototype);
-        Out.push_back(std::make_unique<RVVIntrinsic>(
-            Name, SuffixStr, OverloadedName, OverloadedSuffixStr, MaskedIRName,
-            /*IsMasked=*/true, HasMaskedOffOperand, HasVL, MaskedPolicyScheme,
-            SupportOverloading, HasBuiltinAlias, MaskedManualCodegen,
-            MaskTypes.getValue(), IntrinsicTypes, RequiredFeatures, NF,
-            Policy::PolicyNone, IsPrototypeDefaultTU));
-        if (MaskedPolicyScheme == PolicyScheme::SchemeNone)
-          continue;
-        for (auto P : SupportedMaskedPolicies) {
-          SmallVector<PrototypeDescriptor> PolicyPrototype =
-              RVVIntrinsic::computeBuiltinTypes(
-                  BasicPrototype, /*IsMasked=*/true, HasMaskedOffOperand, HasVL,
-                  NF, IsPrototypeDefaultTU, MaskedPolicyScheme, P);
-          Optional<RVVTypes> PolicyTypes =
-              RVVType::computeTypes(BT, Log2LMUL, NF, PolicyPrototype);
-          Out.push_back(std::make_unique<RVVIntrinsic>(
-              Name, SuffixStr, OverloadedName, OverloadedSuffixStr,
-              MaskedIRName, /*IsMasked=*/true, HasMaskedOffOperand, HasVL,
-              MaskedPolicyScheme, SupportOverloading, HasBuiltinAlias,
-              MaskedManualCodegen, PolicyTypes.getValue(), IntrinsicTypes,
-              RequiredFeatures, NF, P, IsPrototypeDefaultTU));
-        }
-      } // End for Log2LMULList
-    }   // End for TypeRange
 
+  // Reported by -time-phases, to track the cost of expansion as the set of
+  // intrinsics grows.
+  Records.startTimer("Expand RVV intrinsics");
+
+  unsigned ThreadCount = parallel::strategy.compute_thread_count();
+  if (ThreadCount <= 1) {
+    // Plan and expand one record at a time, so that only one plan is alive.
+    for (Record *R : RV)
+      createRVVIntrinsics(R, Out);
+    Records.stopTimer();
+    return;
+  }
+
+  // The types are resolved on this thread, since the type cache is not
+  // thread safe; only the creation of the intrinsics runs concurrently.
+  // Records are handled in batches so that only the plans of one batch are
+  // alive at a time.
+  struct Expansion {
+    RVVIntrinsicPlan Plan;
+    std::vector<std::unique_ptr<RVVIntrinsic>> Intrinsics;
+  };
+  const size_t BatchSize = 8 * ThreadCount;
+  for (size_t Begin = 0, E = RV.size(); Begin != E;) {
+    size_t End = std::min(E, Begin + BatchSize);
+    std::vector<Expansion> Expansions(End - Begin);
+    for (size_t I = Begin; I != End; ++I)
+      planRVVIntrinsics(RV[I], Expansions[I - Begin].Plan);
+
+    parallelForEach(Expansions, [](Expansion &X) {
+      createRVVIntrinsics(X.Plan, X.Intrinsics);
+    });
+
+    // Append in record order so that the result does not depend on the
+    // scheduling.
+    for (Expansion &X : Expansions)
+      std::move(X.Intrinsics.begin(), X.Intrinsics.end(),
+                std::back_inserter(Out));
+    Begin = End;
+  }
+
+  Records.stopTimer();
+}
+
+void RVVEmitter::createRVVIntrinsics(
+    Record *R, std::vector<std::unique_ptr<RVVIntrinsic>> &Out) {
+  RVVIntrinsicPlan Plan;
+  planRVVIntrinsics(R, Plan);
+  createRVVIntrinsics(Plan, Out);
+}
+
+void RVVEmitter::planRVVIntrinsics(Record *R, RVVIntrinsicPlan &Plan) {
+  StringRef SuffixProto = R->getValueAsString("Suffix");
+  StringRef OverloadedSuffixProto = R->getValueAsString("OverloadedSuffix");
+  StringRef Prototypes = R->getValueAsString("Prototype");
+  StringRef TypeRange = R->getValueAsString("TypeRange");
+  Record *MPSRecord = R->getValueAsDef("MaskedPolicyScheme");
+  Record *UMPSRecord = R->getValueAsDef("UnMaskedPolicyScheme");
+  std::vector<int64_t> Log2LMULList = R->getValueAsListOfInts("Log2LMUL");
+  bool HasTailPolicy = R->getValueAsBit("HasTailPolicy");
+  bool HasMaskPolicy = R->getValueAsBit("HasMaskPolicy");
+
+  Plan.Name = R->getValueAsString("Name");
+  Plan.OverloadedName = R->getValueAsString("OverloadedName");
+  Plan.IRName = R->getValueAsString("IRName");
+  Plan.MaskedIRName = R->getValueAsString("MaskedIRName");
+  Plan.ManualCodegen = R->getValueAsString("ManualCodegen");
+  Plan.MaskedManualCodegen = R->getValueAsString("MaskedManualCodegen");
+  Plan.HasMasked = R->getValueAsBit("HasMasked");
+  Plan.HasMaskedOffOperand = R->getValueAsBit("HasMaskedOffOperand");
+  Plan.HasVL = R->getValueAsBit("HasVL");
+  Plan.SupportOverloading = R->getValueAsBit("SupportOverloading");
+  Plan.HasBuiltinAlias = R->getValueAsBit("HasBuiltinAlias");
+  Plan.IsPrototypeDefaultTU = R->getValueAsBit("IsPrototypeDefaultTU");
+  Plan.MaskedPolicyScheme =
+      static_cast<PolicyScheme>(MPSRecord->getValueAsInt("Value"));
+  Plan.UnMaskedPolicyScheme =
+      static_cast<PolicyScheme>(UMPSRecord->getValueAsInt("Value"));
+  Plan.IntrinsicTypes = R->getValueAsListOfInts("IntrinsicTypes");
+  Plan.RequiredFeatures = R->getValueAsListOfStrings("RequiredFeatures");
+  Plan.NF = R->getValueAsInt("NF");
+
+  // If unmasked builtin supports policy, they should be TU or TA.
+  Plan.SupportedUnMaskedPolicies = {Policy::TU, Policy::TA};
+  Plan.SupportedMaskedPolicies =
+      RVVIntrinsic::getSupportedMaskedPolicies(HasTailPolicy, HasMaskPolicy);
+
+  bool HasVL = Plan.HasVL;
+  bool HasMaskedOffOperand = Plan.HasMaskedOffOperand;
+  bool IsPrototypeDefaultTU = Plan.IsPrototypeDefaultTU;
+  unsigned NF = Plan.NF;
+
+  // Parse prototype and create a list of primitive type with transformers
+  // (operand) in Prototype. Prototype[0] is output operand.
+  SmallVector<PrototypeDescriptor> BasicPrototype = parsePrototypes(Prototypes);
+
+  SmallVector<PrototypeDescriptor> SuffixDesc = parsePrototypes(SuffixProto);
+  SmallVector<PrototypeDescriptor> OverloadedSuffixDesc =
+      parsePrototypes(OverloadedSuffixProto);
+
+  // Compute Builtin types
+  auto Prototype = RVVIntrinsic::computeBuiltinTypes(
+      BasicPrototype, /*IsMasked=*/false,
+      /*HasMaskedOffOperand=*/false, HasVL, NF, IsPrototypeDefaultTU,
+      Plan.UnMaskedPolicyScheme);
+  SmallVector<SmallVector<PrototypeDescriptor>, 2> UnMaskedPolicyPrototypes;
+  if (Plan.UnMaskedPolicyScheme != PolicyScheme::SchemeNone)
+    for (auto P : Plan.SupportedUnMaskedPolicies)
+      UnMaskedPolicyPrototypes.push_back(RVVIntrinsic::computeBuiltinTypes(
+          BasicPrototype, /*IsMasked=*/false,
+          /*HasMaskedOffOperand=*/false, HasVL, NF, IsPrototypeDefaultTU,
+          Plan.UnMaskedPolicyScheme, P));
+  SmallVector<SmallVector<PrototypeDescriptor>, 6> MaskedPolicyPrototypes;
+  if (Plan.HasMasked && Plan.MaskedPolicyScheme != PolicyScheme::SchemeNone)
+    for (auto P : Plan.SupportedMaskedPolicies)
+      MaskedPolicyPrototypes.push_back(RVVIntrinsic::computeBuiltinTypes(
+          BasicPrototype, /*IsMasked=*/true, HasMaskedOffOperand, HasVL, NF,
+          IsPrototypeDefaultTU, Plan.MaskedPolicyScheme, P));
+
+  // Resolve the types for each type and LMUL.
+  for (char I : TypeRange) {
+    for (int Log2LMUL : Log2LMULList) {
+      BasicType BT = ParseBasicType(I);
+      Optional<RVVTypes> Types =
+          RVVType::computeTypes(BT, Log2LMUL, NF, Prototype);
+      // Ignored to create new intrinsic if there are any illegal types.
+      if (!Types)
+        continue;
+
+      RVVIntrinsicPlan::Variant V;
+      V.SuffixStr = RVVIntrinsic::getSuffixStr(BT, Log2LMUL, SuffixDesc);
+      V.OverloadedSuffixStr =
+          RVVIntrinsic::getSuffixStr(BT, Log2LMUL, OverloadedSuffixDesc);
+      V.Types = *Types;
+      for (const auto &PolicyPrototype : UnMaskedPolicyPrototypes)
+        V.UnMaskedPolicyTypes.push_back(
+            RVVType::computeTypes(BT, Log2LMUL, NF, PolicyPrototype)
+                .getValue());
+      if (Plan.HasMasked)
+        V.MaskTypes =
+            RVVType::computeTypes(BT, Log2LMUL, NF, Prototype).getValue();
+      for (const auto &PolicyPrototype : MaskedPolicyPrototypes)
+        V.MaskedPolicyTypes.push_back(
+            RVVType::computeTypes(BT, Log2LMUL, NF, PolicyPrototype)
+                .getValue());
+      Plan.Variants.push_back(std::move(V));
+    } // End for Log2LMULList
+  }   // End for TypeRange
+}
+
+void RVVEmitter::createRVVIntrinsics(
+    const RVVIntrinsicPlan &P,
+    std::vector<std::unique_ptr<RVVIntrinsic>> &Out) {
+  for (const RVVIntrinsicPlan::Variant &V : P.Variants) {
+    // Create a unmasked intrinsic
+    Out.push_back(std::make_unique<RVVIntrinsic>(
+        P.Name, V.SuffixStr, P.OverloadedName, V.OverloadedSuffixStr,
+        P.IRName, /*IsMasked=*/false, /*HasMaskedOffOperand=*/false, P.HasVL,
+        P.UnMaskedPolicyScheme, P.SupportOverloading, P.HasBuiltinAlias,
+        P.ManualCodegen, V.Types, P.IntrinsicTypes, P.RequiredFeatures, P.NF,
+        Policy::PolicyNone, P.IsPrototypeDefaultTU));
+    for (size_t I = 0, E = V.UnMaskedPolicyTypes.size(); I != E; ++I)
+      Out.push_back(std::make_unique<RVVIntrinsic>(
+          P.Name, V.SuffixStr, P.OverloadedName, V.OverloadedSuffixStr,
+          P.IRName, /*IsMask=*/false, /*HasMaskedOffOperand=*/false, P.HasVL,
+          P.UnMaskedPolicyScheme, P.SupportOverloading, P.HasBuiltinAlias,
+          P.ManualCodegen, V.UnMaskedPolicyTypes[I], P.IntrinsicTypes,
+          P.RequiredFeatures, P.NF, P.SupportedUnMaskedPolicies[I],
+          P.IsPrototypeDefaultTU));
+    if (!P.HasMasked)
+      continue;
+    // Create a masked intrinsic
+    Out.push_back(std::make_unique<RVVIntrinsic>(
+        P.Name, V.SuffixStr, P.OverloadedName, V.OverloadedSuffixStr,
+        P.MaskedIRName, /*IsMasked=*/true, P.HasMaskedOffOperand, P.HasVL,
+        P.MaskedPolicyScheme, P.SupportOverloading, P.HasBuiltinAlias,
+        P.MaskedManualCodegen, V.MaskTypes, P.IntrinsicTypes,
+        P.RequiredFeatures, P.NF, Policy::PolicyNone, P.IsPrototypeDefaultTU));
+    for (size_t I = 0, E = V.MaskedPolicyTypes.size(); I != E; ++I)
+      Out.push_back(std::make_unique<RVVIntrinsic>(
+          P.Name, V.SuffixStr, P.OverloadedName, V.OverloadedSuffixStr,
+          P.MaskedIRName, /*IsMasked=*/true, P.HasMaskedOffOperand, P.HasVL,
+          P.MaskedPolicyScheme, P.SupportOverloading, P.HasBuiltinAlias,
+          P.MaskedManualCodegen, V.MaskedPolicyTypes[I], P.IntrinsicTypes,
+          P.RequiredFeatures, P.NF, P.SupportedMaskedPolicies[I],
+          P.IsPrototypeDefaultTU));
+  }
+}
+
+void RVVEmitter::createSemaRecords(std::vector<SemaRecord> &Out) {
+  for (Record *R : Records.getAllDerivedDefinitions("RVVBuiltin")) {
+    StringRef Name = R->getValueAsString("Name");
     // We don't emit vsetvli and vsetvlimax for SemaRecord.
     // They are written in riscv_vector.td and will emit those marco define in
     // riscv_vector.h
     if (Name == "vsetvli" || Name == "vsetvlimax")
       continue;
 
-    if (!SemaRecords)
-      continue;
+    StringRef TypeRange = R->getValueAsString("TypeRange");
+    std::vector<int64_t> Log2LMULList = R->getValueAsListOfInts("Log2LMUL");
+    std::vector<StringRef> RequiredFeatures =
+        R->getValueAsListOfStrings("RequiredFeatures");
 
     // Create SemaRecord
     SemaRecord SR;
     SR.Name = Name.str();
-    SR.OverloadedName = OverloadedName.str();
+    SR.OverloadedName = R->getValueAsString("OverloadedName").str();
     BasicType TypeRangeMask = BasicType::Unknown;
     for (char I : TypeRange)
       TypeRangeMask |= ParseBasicType(I);
@@ -649,20 +939,23 @@ void RVVEmitter::createRVVIntrinsics(
       SR.RequiredExtensions |= RequireExt;
     }
 
-    SR.NF = NF;
-    SR.HasMasked = HasMasked;
-    SR.HasVL = HasVL;
-    SR.HasMaskedOffOperand = HasMaskedOffOperand;
-    SR.IsPrototypeDefaultTU = IsPrototypeDefaultTU;
-    SR.HasTailPolicy = HasTailPolicy;
-    SR.HasMaskPolicy = HasMaskPolicy;
-    SR.UnMaskedPolicyScheme = static_cast<uint8_t>(UnMaskedPolicyScheme);
-    SR.MaskedPolicyScheme = static_cast<uint8_t>(MaskedPolicyScheme);
-    SR.Prototype = std::move(BasicPrototype);
-    SR.Suffix = parsePrototypes(SuffixProto);
-    SR.OverloadedSuffix = parsePrototypes(OverloadedSuffixProto);
-
-    SemaRecords->push_back(SR);
+    SR.NF = R->getValueAsInt("NF");
+    SR.HasMasked = R->getValueAsBit("HasMasked");
+    SR.HasVL = R->getValueAsBit("HasVL");
+    SR.HasMaskedOffOperand = R->getValueAsBit("HasMaskedOffOperand");
+    SR.IsPrototypeDefaultTU = R->getValueAsBit("IsPrototypeDefaultTU");
+    SR.HasTailPolicy = R->getValueAsBit("HasTailPolicy");
+    SR.HasMaskPolicy = R->getValueAsBit("HasMaskPolicy");
+    SR.UnMaskedPolicyScheme = static_cast<uint8_t>(
+        R->getValueAsDef("UnMaskedPolicyScheme")->getValueAsInt("Value"));
+    SR.MaskedPolicyScheme = static_cast<uint8_t>(
+        R->getValueAsDef("MaskedPolicyScheme")->getValueAsInt("Value"));
+    SR.Prototype = parsePrototypes(R->getValueAsString("Prototype"));
+    SR.Suffix = parsePrototypes(R->getValueAsString("Suffix"));
+    SR.OverloadedSuffix =
+        parsePrototypes(R->getValueAsString("OverloadedSuffix"));
+
+    Out.push_back(SR);
   }
 }
 
@@ -714,13 +1007,11 @@ void RVVEmitter::createRVVIntrinsicRecords(std::vector<RVVIntrinsicRecord> &Out,
 }
 
 void RVVEmitter::createSema(raw_ostream &OS) {
-  std::vector<std::unique_ptr<RVVIntrinsic>> Defs;
   std::vector<RVVIntrinsicRecord> RVVIntrinsicRecords;
   SemaSignatureTable SST;
   std::vector<SemaRecord> SemaRecords;
 
-  createRVVIntrinsics(Defs, &SemaRecords);
-
+  createSemaRecords(SemaRecords);
   createRVVIntrinsicRecords(RVVIntrinsicRecords, SST, SemaRecords);
 
   // Emit signature table for SemaRISCVVectorLookup.cpp.
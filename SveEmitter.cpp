@@ -23,15 +23,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "TableGenBackends.h"
 #include "llvm/ADT/STLExtras.h"
-#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/TableGen/Record.h"
 #include "llvm/TableGen/Error.h"
 #include <string>
 #include <sstream>
-#include <set>
+#include <map>
 #include <cctype>
 #include <tuple>
 
@@ -169,6 +170,9 @@ class Intrinsic {
 
   SmallVector<ImmCheck, 2> ImmChecks;
 
+  /// The name mangled for ClassS, which is the name of the builtin.
+  std::string MangledName;
+
 public:
   Intrinsic(StringRef Name, StringRef Proto, uint64_t MergeTy,
             StringRef MergeSuffix, uint64_t MemoryElementTy, StringRef LLVMName,
@@ -177,7 +181,7 @@ public:
 
   ~Intrinsic()=default;
 
-  std::string getName() const { return Name; }
+  const std::string &getName() const { return Name; }
   std::string getLLVMName() const { return LLVMName; }
   std::string getProto() const { return Proto; }
   TypeSpec getBaseTypeSpec() const { return BaseTypeSpec; }
@@ -201,7 +205,7 @@ public:
 
   /// Return the name, mangled with type information. The name is mangled for
   /// ClassS, so will add type suffixes such as _u32/_s32.
-  std::string getMangledName() const { return mangleName(ClassS); }
+  const std::string &getMangledName() const { return MangledName; }
 
   /// Returns true if the intrinsic is overloaded, in that it should also generate
   /// a short form without the type-specifiers, e.g. 'svld1(..)' instead of
@@ -257,79 +261,122 @@ private:
       {"f32", "svfloat32_t", "q4f"}, {"f64", "svfloat64_t", "q2d"}};
 
   RecordKeeper &Records;
-  llvm::StringMap<uint64_t> EltTypes;
-  llvm::StringMap<uint64_t> MemEltTypes;
-  llvm::StringMap<uint64_t> FlagTypes;
-  llvm::StringMap<uint64_t> MergeTypes;
-  llvm::StringMap<uint64_t> ImmCheckTypes;
+
+  /// The intrinsics of every Inst record, in record order. They are created
+  /// on first use.
+  SmallVector<std::unique_ptr<Intrinsic>, 128> Defs;
+  bool CreatedIntrinsics = false;
+
+  /// Defs sorted by mangled name, i.e. in BuiltinID order.
+  SmallVector<Intrinsic *, 128> DefsByBuiltin;
+
+  /// The names and values of the records of one class, in record order.
+  using NamedValueList = std::vector<std::pair<StringRef, uint64_t>>;
 
 public:
-  SVEEmitter(RecordKeeper &R) : Records(R) {
-    for (auto *RV : Records.getAllDerivedDefinitions("EltType"))
-      EltTypes[RV->getNameInitAsString()] = RV->getValueAsInt("Value");
-    for (auto *RV : Records.getAllDerivedDefinitions("MemEltType"))
-      MemEltTypes[RV->getNameInitAsString()] = RV->getValueAsInt("Value");
-    for (auto *RV : Records.getAllDerivedDefinitions("FlagType"))
-      FlagTypes[RV->getNameInitAsString()] = RV->getValueAsInt("Value");
-    for (auto *RV : Records.getAllDerivedDefinitions("MergeType"))
-      MergeTypes[RV->getNameInitAsString()] = RV->getValueAsInt("Value");
-    for (auto *RV : Records.getAllDerivedDefinitions("ImmCheckType"))
-      ImmCheckTypes[RV->getNameInitAsString()] = RV->getValueAsInt("Value");
+  /// The element types that encodeTypeFlags can produce.
+  enum EltTypeKind {
+    EltInt8,
+    EltInt16,
+    EltInt32,
+    EltInt64,
+    EltFloat16,
+    EltFloat32,
+    EltFloat64,
+    EltBool8,
+    EltBool16,
+    EltBool32,
+    EltBool64,
+    EltBFloat16,
+    NumEltTypeKinds
+  };
+
+  /// The bit fields of SVETypeFlags that are filled in for every intrinsic.
+  enum FlagFieldKind {
+    EltTypeField,
+    MemEltTypeField,
+    MergeTypeField,
+    SplatOperandField,
+    NumFlagFieldKinds
+  };
+
+private:
+  struct FlagField {
+    uint64_t Mask;
+    unsigned Shift;
+  };
+
+  // The record values needed to encode each intrinsic. Each one is looked up
+  // by name the first time it is used and then kept, so outputs that never
+  // encode an intrinsic don't depend on these records.
+  mutable Optional<uint64_t> EncodedEltTypes[NumEltTypeKinds];
+  mutable Optional<FlagField> FlagFields[NumFlagFieldKinds];
+  mutable Optional<uint64_t> IsOverloadNoneFlag;
+  mutable Optional<uint64_t> ImmCheckPredicatePattern;
+  mutable Optional<uint64_t> ImmCheckPrefetchOp;
+
+  /// Return the Value of the record \p Name, which must be a \p Class.
+  uint64_t getRecordValue(StringRef Name, StringRef Class) const;
+
+  /// Return the Value of the record \p Name, looking it up only if \p Cache
+  /// doesn't already hold it.
+  uint64_t getRecordValue(Optional<uint64_t> &Cache, StringRef Name,
+                          StringRef Class) const {
+    if (!Cache)
+      Cache = getRecordValue(Name, Class);
+    return *Cache;
   }
 
-  /// Returns the enum value for the immcheck type
-  unsigned getEnumValueForImmCheck(StringRef C) const {
-    auto It = ImmCheckTypes.find(C);
-    if (It != ImmCheckTypes.end())
-      return It->getValue();
-    llvm_unreachable("Unsupported imm check");
+  const FlagField &getFlagField(FlagFieldKind F) const;
+
+  NamedValueList getNamedValues(StringRef Class) const;
+
+public:
+  SVEEmitter(RecordKeeper &R) : Records(R) {}
+
+  /// Returns the ImmCheckType value used for predicate pattern operands.
+  unsigned getImmCheckForPredicatePattern() const {
+    return getRecordValue(ImmCheckPredicatePattern, "ImmCheck0_31",
+                          "ImmCheckType");
   }
 
-  /// Returns the enum value for the flag type
-  uint64_t getEnumValueForFlag(StringRef C) const {
-    auto Res = FlagTypes.find(C);
-    if (Res != FlagTypes.end())
-      return Res->getValue();
-    llvm_unreachable("Unsupported flag");
+  /// Returns the ImmCheckType value used for prefetch operation operands.
+  unsigned getImmCheckForPrefetchOp() const {
+    return getRecordValue(ImmCheckPrefetchOp, "ImmCheck0_13", "ImmCheckType");
   }
 
-  // Returns the SVETypeFlags for a given value and mask.
-  uint64_t encodeFlag(uint64_t V, StringRef MaskName) const {
-    auto It = FlagTypes.find(MaskName);
-    if (It != FlagTypes.end()) {
-      uint64_t Mask = It->getValue();
-      unsigned Shift = llvm::countTrailingZeros(Mask);
-      return (V << Shift) & Mask;
-    }
-    llvm_unreachable("Unsupported flag");
+  /// Returns the IsOverloadNone flag.
+  uint64_t getIsOverloadNoneFlag() const {
+    return getRecordValue(IsOverloadNoneFlag, "IsOverloadNone", "FlagType");
   }
 
-  // Returns the SVETypeFlags for the given element type.
-  uint64_t encodeEltType(StringRef EltName) {
-    auto It = EltTypes.find(EltName);
-    if (It != EltTypes.end())
-      return encodeFlag(It->getValue(), "EltTypeMask");
-    llvm_unreachable("Unsupported EltType");
+  // Returns the SVETypeFlags for a given value and field.
+  uint64_t encodeFlag(uint64_t V, FlagFieldKind F) const {
+    const FlagField &Field = getFlagField(F);
+    return (V << Field.Shift) & Field.Mask;
   }
 
+  // Returns the SVETypeFlags for the given element type.
+  uint64_t encodeEltType(EltTypeKind K) const;
+
   // Returns the SVETypeFlags for the given memory element type.
-  uint64_t encodeMemoryElementType(uint64_t MT) {
-    return encodeFlag(MT, "MemEltTypeMask");
+  uint64_t encodeMemoryElementType(uint64_t MT) const {
+    return encodeFlag(MT, MemEltTypeField);
   }
 
   // Returns the SVETypeFlags for the given merge type.
-  uint64_t encodeMergeType(uint64_t MT) {
-    return encodeFlag(MT, "MergeTypeMask");
+  uint64_t encodeMergeType(uint64_t MT) const {
+    return encodeFlag(MT, MergeTypeField);
   }
 
   // Returns the SVETypeFlags for the given splat operand.
-  unsigned encodeSplatOperand(unsigned SplatIdx) {
+  unsigned encodeSplatOperand(unsigned SplatIdx) const {
     assert(SplatIdx < 7 && "SplatIdx out of encodable range");
-    return encodeFlag(SplatIdx + 1, "SplatOperandMask");
+    return encodeFlag(SplatIdx + 1, SplatOperandField);
   }
 
   // Returns the SVETypeFlags value for the given SVEType.
-  uint64_t encodeTypeFlags(const SVEType &T);
+  uint64_t encodeTypeFlags(const SVEType &T) const;
 
   /// Emit arm_sve.h.
   void createHeader(raw_ostream &o);
@@ -343,11 +390,22 @@ public:
   /// Emit all the range checks for the immediates.
   void createRangeChecks(raw_ostream &o);
 
+  /// Emit the range checks for the immediates as a table of check sequences
+  /// and a span of that table for each builtin.
+  void createRangeCheckTable(raw_ostream &o);
+
   /// Create the SVETypeFlags used in CGBuiltins
   void createTypeFlags(raw_ostream &o);
 
   /// Create intrinsic and add it to \p Out
   void createIntrinsic(Record *R, SmallVectorImpl<std::unique_ptr<Intrinsic>> &Out);
+
+  /// Return the intrinsics of every Inst record, creating them if needed.
+  ArrayRef<std::unique_ptr<Intrinsic>> getIntrinsics();
+
+  /// Return the intrinsics sorted by mangled name, which is the order of
+  /// their BuiltinIDs.
+  ArrayRef<Intrinsic *> getIntrinsicsByBuiltin();
 };
 
 } // end anonymous namespace
@@ -827,10 +885,10 @@ Intrinsic::Intrinsic(StringRef Name, StringRef Proto, uint64_t MergeTy,
     if (I > 0) {
       if (T.isPredicatePattern())
         ImmChecks.emplace_back(
-            I - 1, Emitter.getEnumValueForImmCheck("ImmCheck0_31"));
+            I - 1, Emitter.getImmCheckForPredicatePattern());
       else if (T.isPrefetchOp())
         ImmChecks.emplace_back(
-            I - 1, Emitter.getEnumValueForImmCheck("ImmCheck0_13"));
+            I - 1, Emitter.getImmCheckForPrefetchOp());
     }
   }
 
@@ -840,6 +898,8 @@ Intrinsic::Intrinsic(StringRef Name, StringRef Proto, uint64_t MergeTy,
   this->Flags |= Emitter.encodeMergeType(MergeTy);
   if (hasSplat())
     this->Flags |= Emitter.encodeSplatOperand(getSplatIdx());
+
+  MangledName = mangleName(ClassS);
 }
 
 std::string Intrinsic::getBuiltinTypeStr() {
@@ -940,15 +1000,51 @@ void Intrinsic::emitIntrinsic(raw_ostream &OS) const {
 //===----------------------------------------------------------------------===//
 // SVEEmitter implementation
 //===----------------------------------------------------------------------===//
-uint64_t SVEEmitter::encodeTypeFlags(const SVEType &T) {
+const SVEEmitter::FlagField &SVEEmitter::getFlagField(FlagFieldKind F) const {
+  static const char *const FlagFieldNames[NumFlagFieldKinds] = {
+      "EltTypeMask", "MemEltTypeMask", "MergeTypeMask", "SplatOperandMask"};
+  if (!FlagFields[F]) {
+    uint64_t Mask = getRecordValue(FlagFieldNames[F], "FlagType");
+    FlagFields[F] = FlagField{Mask, (unsigned)llvm::countTrailingZeros(Mask)};
+  }
+  return *FlagFields[F];
+}
+
+uint64_t SVEEmitter::encodeEltType(EltTypeKind K) const {
+  static const char *const EltTypeNames[NumEltTypeKinds] = {
+      "EltTyInt8",    "EltTyInt16",    "EltTyInt32",   "EltTyInt64",
+      "EltTyFloat16", "EltTyFloat32",  "EltTyFloat64", "EltTyBool8",
+      "EltTyBool16",  "EltTyBool32",   "EltTyBool64",  "EltTyBFloat16"};
+  if (!EncodedEltTypes[K])
+    EncodedEltTypes[K] =
+        encodeFlag(getRecordValue(EltTypeNames[K], "EltType"), EltTypeField);
+  return *EncodedEltTypes[K];
+}
+
+uint64_t SVEEmitter::getRecordValue(StringRef Name, StringRef Class) const {
+  Record *R = Records.getDef(Name);
+  if (!R || !R->isSubClassOf(Class))
+    PrintFatalError("SVE " + Class + " '" + Name + "' is not defined");
+  return R->getValueAsInt("Value");
+}
+
+SVEEmitter::NamedValueList
+SVEEmitter::getNamedValues(StringRef Class) const {
+  NamedValueList Values;
+  for (auto *RV : Records.getAllDerivedDefinitions(Class))
+    Values.emplace_back(RV->getName(), RV->getValueAsInt("Value"));
+  return Values;
+}
+
+uint64_t SVEEmitter::encodeTypeFlags(const SVEType &T) const {
   if (T.isFloat()) {
     switch (T.getElementSizeInBits()) {
     case 16:
-      return encodeEltType("EltTyFloat16");
+      return encodeEltType(EltFloat16);
     case 32:
-      return encodeEltType("EltTyFloat32");
+      return encodeEltType(EltFloat32);
     case 64:
-      return encodeEltType("EltTyFloat64");
+      return encodeEltType(EltFloat64);
     default:
       llvm_unreachable("Unhandled float element bitwidth!");
     }
@@ -956,19 +1052,19 @@ uint64_t SVEEmitter::encodeTypeFlags(const SVEType &T) {
 
   if (T.isBFloat()) {
     assert(T.getElementSizeInBits() == 16 && "Not a valid BFloat.");
-    return encodeEltType("EltTyBFloat16");
+    return encodeEltType(EltBFloat16);
   }
 
   if (T.isPredicateVector()) {
     switch (T.getElementSizeInBits()) {
     case 8:
-      return encodeEltType("EltTyBool8");
+      return encodeEltType(EltBool8);
     case 16:
-      return encodeEltType("EltTyBool16");
+      return encodeEltType(EltBool16);
     case 32:
-      return encodeEltType("EltTyBool32");
+      return encodeEltType(EltBool32);
     case 64:
-      return encodeEltType("EltTyBool64");
+      return encodeEltType(EltBool64);
     default:
       llvm_unreachable("Unhandled predicate element bitwidth!");
     }
@@ -976,13 +1072,13 @@ uint64_t SVEEmitter::encodeTypeFlags(const SVEType &T) {
 
   switch (T.getElementSizeInBits()) {
   case 8:
-    return encodeEltType("EltTyInt8");
+    return encodeEltType(EltInt8);
   case 16:
-    return encodeEltType("EltTyInt16");
+    return encodeEltType(EltInt16);
   case 32:
-    return encodeEltType("EltTyInt32");
+    return encodeEltType(EltInt32);
   case 64:
-    return encodeEltType("EltTyInt64");
+    return encodeEltType(EltInt64);
   default:
     llvm_unreachable("Unhandled integer element bitwidth!");
   }
@@ -1007,7 +1103,7 @@ void SVEEmitter::createIntrinsic(
 
   // Create a dummy TypeSpec for non-overloaded builtins.
   if (Types.empty()) {
-    assert((Flags & getEnumValueForFlag("IsOverloadNone")) &&
+    assert((Flags & getIsOverloadNoneFlag()) &&
            "Expect TypeSpec for overloaded builtin!");
     Types = "i";
   }
@@ -1058,6 +1154,27 @@ void SVEEmitter::createIntrinsic(
   }
 }
 
+ArrayRef<std::unique_ptr<Intrinsic>> SVEEmitter::getIntrinsics() {
+  if (!CreatedIntrinsics) {
+    for (auto *R : Records.getAllDerivedDefinitions("Inst"))
+      createIntrinsic(R, Defs);
+    CreatedIntrinsics = true;
+  }
+  return Defs;
+}
+
+ArrayRef<Intrinsic *> SVEEmitter::getIntrinsicsByBuiltin() {
+  if (DefsByBuiltin.empty() && !getIntrinsics().empty()) {
+    for (auto &Def : Defs)
+      DefsByBuiltin.push_back(Def.get());
+    llvm::stable_sort(DefsByBuiltin,
+                      [](const Intrinsic *A, const Intrinsic *B) {
+                        return A->getMangledName() < B->getMangledName();
+                      });
+  }
+  return DefsByBuiltin;
+}
+
 void SVEEmitter::createHeader(raw_ostream &OS) {
   OS << "/*===---- arm_sve.h - ARM SVE intrinsics "
         "-----------------------------------===\n"
@@ -1227,26 +1344,24 @@ void SVEEmitter::createHeader(raw_ostream &OS) {
           OS << "#endif /* #if defined(__ARM_FEATURE_SVE_BF16) */\n";
       }
 
-  SmallVector<std::unique_ptr<Intrinsic>, 128> Defs;
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
+  SmallVector<Intrinsic *, 128> Defs;
+  for (auto &Def : getIntrinsics())
+    Defs.push_back(Def.get());
 
   // Sort intrinsics in header file by following order/priority:
   // - Architectural guard (i.e. does it require SVE2 or SVE2_AES)
   // - Class (is intrinsic overloaded or not)
   // - Intrinsic name
-  std::stable_sort(
-      Defs.begin(), Defs.end(), [](const std::unique_ptr<Intrinsic> &A,
-                                   const std::unique_ptr<Intrinsic> &B) {
-        auto ToTuple = [](const std::unique_ptr<Intrinsic> &I) {
-          return std::make_tuple(I->getGuard(), (unsigned)I->getClassKind(), I->getName());
-        };
-        return ToTuple(A) < ToTuple(B);
-      });
+  llvm::stable_sort(Defs, [](const Intrinsic *A, const Intrinsic *B) {
+    auto ToTuple = [](const Intrinsic *I) {
+      return std::make_tuple(I->getGuard(), (unsigned)I->getClassKind(),
+                             StringRef(I->getName()));
+    };
+    return ToTuple(A) < ToTuple(B);
+  });
 
   StringRef InGuard = "";
-  for (auto &I : Defs) {
+  for (auto *I : Defs) {
     // Emit #endif/#if pair if needed.
     if (I->getGuard() != InGuard) {
       if (!InGuard.empty())
@@ -1287,19 +1402,11 @@ void SVEEmitter::createHeader(raw_ostream &OS) {
 }
 
 void SVEEmitter::createBuiltins(raw_ostream &OS) {
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  SmallVector<std::unique_ptr<Intrinsic>, 128> Defs;
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
-
   // The mappings must be sorted based on BuiltinID.
-  llvm::sort(Defs, [](const std::unique_ptr<Intrinsic> &A,
-                      const std::unique_ptr<Intrinsic> &B) {
-    return A->getMangledName() < B->getMangledName();
-  });
+  ArrayRef<Intrinsic *> Defs = getIntrinsicsByBuiltin();
 
   OS << "#ifdef GET_SVE_BUILTINS\n";
-  for (auto &Def : Defs) {
+  for (auto *Def : Defs) {
     // Only create BUILTINs for non-overloaded intrinsics, as overloaded
     // declarations only live in the header file.
     if (Def->getClassKind() != ClassG)
@@ -1318,19 +1425,11 @@ void SVEEmitter::createBuiltins(raw_ostream &OS) {
   }
 
 void SVEEmitter::createCodeGenMap(raw_ostream &OS) {
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  SmallVector<std::unique_ptr<Intrinsic>, 128> Defs;
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
-
   // The mappings must be sorted based on BuiltinID.
-  llvm::sort(Defs, [](const std::unique_ptr<Intrinsic> &A,
-                      const std::unique_ptr<Intrinsic> &B) {
-    return A->getMangledName() < B->getMangledName();
-  });
+  ArrayRef<Intrinsic *> Defs = getIntrinsicsByBuiltin();
 
   OS << "#ifdef GET_SVE_LLVM_INTRINSIC_MAP\n";
-  for (auto &Def : Defs) {
+  for (auto *Def : Defs) {
     // Builtins only exist for non-overloaded intrinsics, overloaded
     // declarations only live in the header file.
     if (Def->getClassKind() == ClassG)
@@ -1351,26 +1450,17 @@ void SVEEmitter::createCodeGenMap(raw_ostream &OS) {
 }
 
 void SVEEmitter::createRangeChecks(raw_ostream &OS) {
-  std::vector<Record *> RV = Records.getAllDerivedDefinitions("Inst");
-  SmallVector<std::unique_ptr<Intrinsic>, 128> Defs;
-  for (auto *R : RV)
-    createIntrinsic(R, Defs);
-
   // The mappings must be sorted based on BuiltinID.
-  llvm::sort(Defs, [](const std::unique_ptr<Intrinsic> &A,
-                      const std::unique_ptr<Intrinsic> &B) {
-    return A->getMangledName() < B->getMangledName();
-  });
-
+  ArrayRef<Intrinsic *> Defs = getIntrinsicsByBuiltin();
 
   OS << "#ifdef GET_SVE_IMMEDIATE_CHECK\n";
 
-  // Ensure these are only emitted once.
-  std::set<std::string> Emitted;
+  // Ensure these are only emitted once. Intrinsics with the same name are
+  // adjacent in builtin order.
+  StringRef LastEmitted;
 
-  for (auto &Def : Defs) {
-    if (Emitted.find(Def->getMangledName()) != Emitted.end() ||
-        Def->getImmChecks().empty())
+  for (auto *Def : Defs) {
+    if (Def->getMangledName() == LastEmitted || Def->getImmChecks().empty())
       continue;
 
     OS << "case SVE::BI__builtin_sve_" << Def->getMangledName() << ":\n";
@@ -1379,37 +1469,98 @@ void SVEEmitter::createRangeChecks(raw_ostream &OS) {
          << Check.getKind() << ", " << Check.getElementSizeInBits() << "));\n";
     OS << "  break;\n";
 
-    Emitted.insert(Def->getMangledName());
+    LastEmitted = Def->getMangledName();
+  }
+
+  OS << "#endif\n\n";
+}
+
+void SVEEmitter::createRangeCheckTable(raw_ostream &OS) {
+  using CheckTuple = std::tuple<unsigned, unsigned, unsigned>;
+  using CheckSequence = SmallVector<CheckTuple, 2>;
+
+  // Each distinct sequence of checks is stored once, and builtins with the
+  // same checks share its span.
+  std::vector<CheckTuple> Table;
+  std::map<CheckSequence, unsigned> Offsets;
+  std::vector<std::pair<StringRef, std::pair<unsigned, unsigned>>> Spans;
+
+  for (auto *Def : getIntrinsicsByBuiltin()) {
+    // Only non-overloaded intrinsics have builtins.
+    if (Def->getClassKind() == ClassG)
+      continue;
+
+    CheckSequence Checks;
+    for (auto &Check : Def->getImmChecks())
+      Checks.emplace_back(Check.getArg(), Check.getKind(),
+                          Check.getElementSizeInBits());
+
+    unsigned Offset = 0;
+    if (!Checks.empty()) {
+      auto Ins = Offsets.insert({Checks, Table.size()});
+      if (Ins.second)
+        Table.insert(Table.end(), Checks.begin(), Checks.end());
+      Offset = Ins.first->second;
+    }
+    Spans.push_back({Def->getMangledName(), {Offset, Checks.size()}});
   }
 
+  OS << "#ifdef GET_SVE_IMMEDIATE_CHECK_TABLE\n";
+  for (auto &Check : Table)
+    OS << "SVE_IMMEDIATE_CHECK(" << std::get<0>(Check) << ", "
+       << std::get<1>(Check) << ", " << std::get<2>(Check) << ")\n";
+  OS << "#endif\n\n";
+
+  // One row per builtin, in the order of GET_SVE_BUILTINS, giving the first
+  // check in GET_SVE_IMMEDIATE_CHECK_TABLE and the number of checks.
+  OS << "#ifdef GET_SVE_IMMEDIATE_CHECK_SPANS\n";
+  for (auto &Span : Spans)
+    OS << "SVE_IMMEDIATE_CHECK_SPAN(" << Span.first << ", " << Span.second.first
+       << ", " << Span.second.second << ")\n";
   OS << "#endif\n\n";
 }
 
 /// Create the SVETypeFlags used in CGBuiltins
 void SVEEmitter::createTypeFlags(raw_ostream &OS) {
+  NamedValueList FlagTypes = getNamedValues("FlagType");
+  NamedValueList EltTypes = getNamedValues("EltType");
+  NamedValueList MemEltTypes = getNamedValues("MemEltType");
+  NamedValueList MergeTypes = getNamedValues("MergeType");
+  NamedValueList ImmCheckTypes = getNamedValues("ImmCheckType");
+
   OS << "#ifdef LLVM_GET_SVE_TYPEFLAGS\n";
   for (auto &KV : FlagTypes)
-    OS << "const uint64_t " << KV.getKey() << " = " << KV.getValue() << ";\n";
+    OS << "const uint64_t " << KV.first << " = " << KV.second << ";\n";
+  OS << "#endif\n\n";
+
+  // Each multi-bit field of SVETypeFlags with its mask and shift, so that
+  // CodeGen can decode a field with constants rather than computing the
+  // shift from the mask.
+  OS << "#ifdef LLVM_GET_SVE_TYPEFLAG_FIELDS\n";
+  for (auto &KV : FlagTypes)
+    if (KV.first.endswith("Mask") && llvm::countPopulation(KV.second) > 1)
+      OS << "SVE_TYPEFLAG_FIELD(" << KV.first << ", 0x" << utohexstr(KV.second)
+         << "ULL, " << llvm::countTrailingZeros(KV.second) << ")\n";
   OS << "#endif\n\n";
 
   OS << "#ifdef LLVM_GET_SVE_ELTTYPES\n";
   for (auto &KV : EltTypes)
-    OS << "  " << KV.getKey() << " = " << KV.getValue() << ",\n";
+    OS << "  " << KV.first << " = " << KV.second << ",\n";
   OS << "#endif\n\n";
 
   OS << "#ifdef LLVM_GET_SVE_MEMELTTYPES\n";
   for (auto &KV : MemEltTypes)
-    OS << "  " << KV.getKey() << " = " << KV.getValue() << ",\n";
+    OS << "  " << KV.first << " = " << KV.second << ",\n";
   OS << "#endif\n\n";
 
   OS << "#ifdef LLVM_GET_SVE_MERGETYPES\n";
   for (auto &KV : MergeTypes)
-    OS << "  " << KV.getKey() << " = " << KV.getValue() << ",\n";
+    OS << "  " << KV.first << " = " << KV.second << ",\n";
   OS << "#endif\n\n";
 
   OS << "#ifdef LLVM_GET_SVE_IMMCHECKTYPES\n";
   for (auto &KV : ImmCheckTypes)
-    OS << "  " << KV.getKey() << " = " << KV.getValue() << ",\n";
+    OS << "  " << KV.first << " = " << KV.second << ",\n";
   OS << "#endif\n\n";
 }
 
@@ -1430,8 +1581,28 @@ void EmitSveRangeChecks(RecordKeeper &Records, raw_ostream &OS) {
   SVEEmitter(Records).createRangeChecks(OS);
 }
 
+void EmitSveRangeCheckTable(RecordKeeper &Records, raw_ostream &OS) {
+  SVEEmitter(Records).createRangeCheckTable(OS);
+}
+
 void EmitSveTypeFlags(RecordKeeper &Records, raw_ostream &OS) {
   SVEEmitter(Records).createTypeFlags(OS);
 }
 
+void EmitSveOutputs(RecordKeeper &Records, const SveOutputs &Outputs) {
+  SVEEmitter Emitter(Records);
+  if (Outputs.Header)
+    Emitter.createHeader(*Outputs.Header);
+  if (Outputs.Builtins)
+    Emitter.createBuiltins(*Outputs.Builtins);
+  if (Outputs.BuiltinCG)
+    Emitter.createCodeGenMap(*Outputs.BuiltinCG);
+  if (Outputs.TypeFlags)
+    Emitter.createTypeFlags(*Outputs.TypeFlags);
+  if (Outputs.RangeChecks)
+    Emitter.createRangeChecks(*Outputs.RangeChecks);
+  if (Outputs.RangeCheckTable)
+    Emitter.createRangeCheckTable(*Outputs.RangeCheckTable);
+}
+
 } // End namespace clang
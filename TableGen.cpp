@@ -23,6 +23,7 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TableGen/Error.h"
@@ -35,8 +36,10 @@
 #include<ClangASTNodesEmitter.h>
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Main.h"
 
@@ -92,10 +95,12 @@ enum ActionType {
   GenArmFP16,
   GenArmBF16,
   GenArmNeonSema,
+  GenArmNeonSemaTable,
   GenArmNeonTest,
   GenArmMveHeader,
   GenArmMveBuiltinDef,
   GenArmMveBuiltinSema,
+  GenArmMveBuiltinSemaTable,
   GenArmMveBuiltinCG,
   GenArmMveBuiltinAliases,
   GenArmSveHeader,
@@ -103,9 +108,11 @@ enum ActionType {
   GenArmSveBuiltinCG,
   GenArmSveTypeFlags,
   GenArmSveRangeChecks,
+  GenArmSveRangeCheckTable,
   GenArmCdeHeader,
   GenArmCdeBuiltinDef,
   GenArmCdeBuiltinSema,
+  GenArmCdeBuiltinSemaTable,
   GenArmCdeBuiltinCG,
   GenArmCdeBuiltinAliases,
   GenRISCVVectorHeader,
@@ -229,6 +236,9 @@ cl::opt<ActionType> Action(
         clEnumValN(GenArmBF16, "gen-arm-bf16", "Generate arm_bf16.h for clang"),
         clEnumValN(GenArmNeonSema, "gen-arm-neon-sema",
                    "Generate ARM NEON sema support for clang"),
+        clEnumValN(GenArmNeonSemaTable, "gen-arm-neon-sema-table",
+                   "Generate ARM NEON sema support for clang, with the "
+                   "checks as table rows"),
         clEnumValN(GenArmNeonTest, "gen-arm-neon-test",
                    "Generate ARM NEON tests for clang"),
         clEnumValN(GenArmSveHeader, "gen-arm-sve-header",
@@ -241,12 +251,20 @@ cl::opt<ActionType> Action(
                    "Generate arm_sve_typeflags.inc for clang"),
         clEnumValN(GenArmSveRangeChecks, "gen-arm-sve-sema-rangechecks",
                    "Generate arm_sve_sema_rangechecks.inc for clang"),
+        clEnumValN(GenArmSveRangeCheckTable,
+                   "gen-arm-sve-sema-rangechecks-table",
+                   "Generate arm_sve_sema_rangechecks.inc for clang, with the "
+                   "checks as table rows"),
         clEnumValN(GenArmMveHeader, "gen-arm-mve-header",
                    "Generate arm_mve.h for clang"),
         clEnumValN(GenArmMveBuiltinDef, "gen-arm-mve-builtin-def",
                    "Generate ARM MVE builtin definitions for clang"),
         clEnumValN(GenArmMveBuiltinSema, "gen-arm-mve-builtin-sema",
                    "Generate ARM MVE builtin sema checks for clang"),
+        clEnumValN(GenArmMveBuiltinSemaTable,
+                   "gen-arm-mve-builtin-sema-table",
+                   "Generate ARM MVE builtin sema checks for clang, as table "
+                   "rows"),
         clEnumValN(GenArmMveBuiltinCG, "gen-arm-mve-builtin-codegen",
                    "Generate ARM MVE builtin code-generator for clang"),
         clEnumValN(GenArmMveBuiltinAliases, "gen-arm-mve-builtin-aliases",
@@ -257,6 +275,10 @@ cl::opt<ActionType> Action(
                    "Generate ARM CDE builtin definitions for clang"),
         clEnumValN(GenArmCdeBuiltinSema, "gen-arm-cde-builtin-sema",
                    "Generate ARM CDE builtin sema checks for clang"),
+        clEnumValN(GenArmCdeBuiltinSemaTable,
+                   "gen-arm-cde-builtin-sema-table",
+                   "Generate ARM CDE builtin sema checks for clang, as table "
+                   "rows"),
         clEnumValN(GenArmCdeBuiltinCG, "gen-arm-cde-builtin-codegen",
                    "Generate ARM CDE builtin code-generator for clang"),
         clEnumValN(GenArmCdeBuiltinAliases, "gen-arm-cde-builtin-aliases",
@@ -286,8 +308,153 @@ ClangComponent("clang-component",
                cl::desc("Only use warnings from specified component"),
                cl::value_desc("component"), cl::Hidden);
 
+cl::opt<bool> ClangDiagsAllComponents(
+    "clang-diags-all-components",
+    cl::desc("Emit the diagnostics of every component, each in its own "
+             "DIAG_COMPONENT_<NAME> section"));
+
+cl::opt<bool> ClangDiagsBytecode(
+    "clang-diags-bytecode",
+    cl::desc("Also emit a pre-parsed bytecode form of each diagnostic's text"));
+
+cl::opt<bool> ClangDiagGroupBitsets(
+    "clang-diag-group-bitsets",
+    cl::desc("Also emit the transitive members of each diagnostic group as a "
+             "bitset"));
+
+cl::opt<bool> ClangDiagGroupNameHash(
+    "clang-diag-group-name-hash",
+    cl::desc("Also emit a perfect hash table of diagnostic group names"));
+
+cl::opt<std::string> ClangDiagDocsCache(
+    "clang-diag-docs-cache",
+    cl::desc("Reuse the rendered gen-diag-docs sections of unchanged "
+             "diagnostic groups from this directory. Entries are never "
+             "removed from it, so clean it out by hand"),
+    cl::value_desc("directory"));
+
+cl::opt<std::string> ArmNeonSemaOutput(
+    "arm-neon-sema-output",
+    cl::desc("With -gen-arm-neon or -gen-arm-fp16, also write the output of "
+             "-gen-arm-neon-sema to this file, from the same expansion of the "
+             "intrinsics"),
+    cl::value_desc("filename"));
+
+cl::opt<std::string> ArmNeonSemaTableOutput(
+    "arm-neon-sema-table-output",
+    cl::desc("With -gen-arm-neon or -gen-arm-fp16, also write the output of "
+             "-gen-arm-neon-sema-table to this file, from the same expansion "
+             "of the intrinsics"),
+    cl::value_desc("filename"));
+
+// With any -gen-arm-sve-* action, each of these writes the output of another
+// -gen-arm-sve-* action as well, from the same expansion of the intrinsics.
+cl::opt<std::string> ArmSveHeaderOutput(
+    "arm-sve-header-output",
+    cl::desc("Also write the output of -gen-arm-sve-header to this file"),
+    cl::value_desc("filename"));
+cl::opt<std::string> ArmSveBuiltinsOutput(
+    "arm-sve-builtins-output",
+    cl::desc("Also write the output of -gen-arm-sve-builtins to this file"),
+    cl::value_desc("filename"));
+cl::opt<std::string> ArmSveBuiltinCGOutput(
+    "arm-sve-builtin-codegen-output",
+    cl::desc("Also write the output of -gen-arm-sve-builtin-codegen "
+             "to this file"),
+    cl::value_desc("filename"));
+cl::opt<std::string> ArmSveTypeFlagsOutput(
+    "arm-sve-typeflags-output",
+    cl::desc("Also write the output of -gen-arm-sve-typeflags to this file"),
+    cl::value_desc("filename"));
+cl::opt<std::string> ArmSveRangeChecksOutput(
+    "arm-sve-sema-rangechecks-output",
+    cl::desc("Also write the output of -gen-arm-sve-sema-rangechecks "
+             "to this file"),
+    cl::value_desc("filename"));
+cl::opt<std::string> ArmSveRangeCheckTableOutput(
+    "arm-sve-sema-rangechecks-table-output",
+    cl::desc("Also write the output of -gen-arm-sve-sema-rangechecks-table "
+             "to this file"),
+    cl::value_desc("filename"));
+
+cl::opt<unsigned> Threads(
+    "threads",
+    cl::desc("Number of threads the backends may use to expand records and "
+             "render text, or 0 for one per hardware thread (default 1)"),
+    cl::init(1));
+
+/// Open an output file besides the one given by -o, or return null if
+/// Filename is empty. The file is removed again unless it is kept.
+std::unique_ptr<ToolOutputFile> openExtraOutput(StringRef Filename) {
+  if (Filename.empty())
+    return nullptr;
+  std::error_code EC;
+  auto Out = std::make_unique<ToolOutputFile>(Filename, EC, sys::fs::OF_Text);
+  if (EC)
+    PrintFatalError("cannot open '" + Filename + "': " + EC.message());
+  return Out;
+}
+
+/// Emit a Neon header through Emit, along with the Sema outputs asked for by
+/// -arm-neon-sema-output and -arm-neon-sema-table-output.
+void emitNeonHeaderWithSema(RecordKeeper &Records, raw_ostream &OS,
+                            void (*Emit)(RecordKeeper &, raw_ostream &,
+                                         raw_ostream *, raw_ostream *)) {
+  std::unique_ptr<ToolOutputFile> SemaOut = openExtraOutput(ArmNeonSemaOutput);
+  std::unique_ptr<ToolOutputFile> SemaTableOut =
+      openExtraOutput(ArmNeonSemaTableOutput);
+  Emit(Records, OS, SemaOut ? &SemaOut->os() : nullptr,
+       SemaTableOut ? &SemaTableOut->os() : nullptr);
+  if (SemaOut)
+    SemaOut->keep();
+  if (SemaTableOut)
+    SemaTableOut->keep();
+}
+
+/// Emit the output of an SVE action to OS, into the stream that Main selects,
+/// along with the outputs asked for by the -arm-sve-*-output options.
+void emitSveOutputs(RecordKeeper &Records, raw_ostream &OS,
+                    raw_ostream *SveOutputs::*Main) {
+  SveOutputs Outputs;
+  std::vector<std::unique_ptr<ToolOutputFile>> Files;
+  auto Open = [&](StringRef Filename, raw_ostream *SveOutputs::*Output) {
+    if (Output == Main && !Filename.empty())
+      PrintFatalError("an -arm-sve-*-output option names the output of the "
+                      "action itself");
+    if (std::unique_ptr<ToolOutputFile> File = openExtraOutput(Filename)) {
+      Outputs.*Output = &File->os();
+      Files.push_back(std::move(File));
+    }
+  };
+  Open(ArmSveHeaderOutput, &SveOutputs::Header);
+  Open(ArmSveBuiltinsOutput, &SveOutputs::Builtins);
+  Open(ArmSveBuiltinCGOutput, &SveOutputs::BuiltinCG);
+  Open(ArmSveTypeFlagsOutput, &SveOutputs::TypeFlags);
+  Open(ArmSveRangeChecksOutput, &SveOutputs::RangeChecks);
+  Open(ArmSveRangeCheckTableOutput, &SveOutputs::RangeCheckTable);
+  Outputs.*Main = &OS;
+
+  EmitSveOutputs(Records, Outputs);
+  for (auto &File : Files)
+    File->keep();
+}
 
 bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
+  // The backends use parallelForEach, which runs serially with one thread.
+  parallel::strategy = hardware_concurrency(Threads);
+
+  if ((!ArmNeonSemaOutput.empty() || !ArmNeonSemaTableOutput.empty()) &&
+      Action != GenArmNeon && Action != GenArmFP16)
+    PrintFatalError("-arm-neon-sema-output and -arm-neon-sema-table-output "
+                    "require -gen-arm-neon or -gen-arm-fp16");
+  if ((!ArmSveHeaderOutput.empty() || !ArmSveBuiltinsOutput.empty() ||
+       !ArmSveBuiltinCGOutput.empty() || !ArmSveTypeFlagsOutput.empty() ||
+       !ArmSveRangeChecksOutput.empty() ||
+       !ArmSveRangeCheckTableOutput.empty()) &&
+      (Action < GenArmSveHeader || Action > GenArmSveRangeCheckTable))
+    PrintFatalError("the -arm-sve-*-output options require a "
+                    "-gen-arm-sve-* action");
+
   switch (Action) {
   case PrintRecords:
     OS << Records;           // No argument, dump all contents
@@ -350,10 +517,22 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
     EmitClangAttrNodeTraverse(Records, OS);
     break;
   case GenClangDiagsDefs:
-    EmitClangDiagsDefs(Records, OS, ClangComponent);
+    if (ClangDiagsAllComponents) {
+      if (!ClangComponent.empty())
+        PrintFatalError("-clang-diags-all-components cannot be combined with "
+                        "-clang-component");
+      EmitClangAllDiagsDefs(Records, OS, ClangDiagsBytecode);
+    } else if (ClangDiagsBytecode)
+      EmitClangDiagsDefsBytecode(Records, OS, ClangComponent);
+    else
+      EmitClangDiagsDefs(Records, OS, ClangComponent);
     break;
   case GenClangDiagGroups:
     EmitClangDiagGroups(Records, OS);
+    if (ClangDiagGroupBitsets)
+      EmitClangDiagGroupBitsets(Records, OS);
+    if (ClangDiagGroupNameHash)
+      EmitClangDiagGroupNameHash(Records, OS);
     break;
   case GenClangDiagsIndexName:
     EmitClangDiagsIndexName(Records, OS);
@@ -417,10 +596,10 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
     EmitClangSyntaxNodeClasses(Records, OS);
     break;
   case GenArmNeon:
-    EmitNeon(Records, OS);
+    emitNeonHeaderWithSema(Records, OS, EmitNeonWithSema);
     break;
   case GenArmFP16:
-    EmitFP16(Records, OS);
+    emitNeonHeaderWithSema(Records, OS, EmitFP16WithSema);
     break;
   case GenArmBF16:
     EmitBF16(Records, OS);
@@ -428,6 +607,9 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
   case GenArmNeonSema:
     EmitNeonSema(Records, OS);
     break;
+  case GenArmNeonSemaTable:
+    EmitNeonSemaTable(Records, OS);
+    break;
   case GenArmNeonTest:
     EmitNeonTest(Records, OS);
     break;
@@ -440,6 +622,9 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
   case GenArmMveBuiltinSema:
     EmitMveBuiltinSema(Records, OS);
     break;
+  case GenArmMveBuiltinSemaTable:
+    EmitMveBuiltinSemaTable(Records, OS);
+    break;
   case GenArmMveBuiltinCG:
     EmitMveBuiltinCG(Records, OS);
     break;
@@ -447,19 +632,22 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
     EmitMveBuiltinAliases(Records, OS);
     break;
   case GenArmSveHeader:
-    EmitSveHeader(Records, OS);
+    emitSveOutputs(Records, OS, &SveOutputs::Header);
     break;
   case GenArmSveBuiltins:
-    EmitSveBuiltins(Records, OS);
+    emitSveOutputs(Records, OS, &SveOutputs::Builtins);
     break;
   case GenArmSveBuiltinCG:
-    EmitSveBuiltinCG(Records, OS);
+    emitSveOutputs(Records, OS, &SveOutputs::BuiltinCG);
     break;
   case GenArmSveTypeFlags:
-    EmitSveTypeFlags(Records, OS);
+    emitSveOutputs(Records, OS, &SveOutputs::TypeFlags);
     break;
   case GenArmSveRangeChecks:
-    EmitSveRangeChecks(Records, OS);
+    emitSveOutputs(Records, OS, &SveOutputs::RangeChecks);
+    break;
+  case GenArmSveRangeCheckTable:
+    emitSveOutputs(Records, OS, &SveOutputs::RangeCheckTable);
     break;
   case GenArmCdeHeader:
     EmitCdeHeader(Records, OS);
@@ -470,6 +658,9 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
   case GenArmCdeBuiltinSema:
     EmitCdeBuiltinSema(Records, OS);
     break;
+  case GenArmCdeBuiltinSemaTable:
+    EmitCdeBuiltinSemaTable(Records, OS);
+    break;
   case GenArmCdeBuiltinCG:
     EmitCdeBuiltinCG(Records, OS);
     break;
@@ -492,7 +683,10 @@ bool ClangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
     EmitClangAttrDocs(Records, OS);
     break;
   case GenDiagDocs:
-    EmitClangDiagDocs(Records, OS);
+    if (!ClangDiagDocsCache.empty())
+      EmitClangDiagDocsCached(Records, OS, ClangDiagDocsCache);
+    else
+      EmitClangDiagDocs(Records, OS);
     break;
   case GenOptDocs:
     EmitClangOptDocs(Records, OS);